@@ -0,0 +1,172 @@
+#include "apiclient.h"
+#include "perfstats.h"
+
+#include <QJsonDocument>
+#include <QNetworkRequest>
+#include <QRandomGenerator>
+#include <QSslConfiguration>
+#include <QUrl>
+
+static const char *kHost = "api.openai.com";
+
+ApiClient::ApiClient(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void ApiClient::warmUp()
+{
+    // DNS + TCP + TLS now, so the first real request finds an open connection
+    QSslConfiguration ssl = QSslConfiguration::defaultConfiguration();
+    ssl.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2, "http/1.1"});
+    net.connectToHostEncrypted(kHost, 443, ssl);
+}
+
+ApiCall *ApiClient::post(const QByteArray &path, const QJsonObject &body, int deadlineMs)
+{
+    auto *call = new ApiCall(this);
+    call->path = path;
+    call->body = QJsonDocument(body).toJson(QJsonDocument::Compact);
+    call->deadlineMs = deadlineMs;
+    call->age.start();
+    call->submitNs = PerfStats::nowNs();
+
+    call->deadline.setSingleShot(true);
+    connect(&call->deadline, &QTimer::timeout, call, [this, call] { timeout(call); });
+    call->deadline.start(deadlineMs);
+
+    waiting.enqueue(call);
+    pump();
+    return call;
+}
+
+void ApiClient::timeout(ApiCall *call)
+{
+    call->aborted = true;
+    const QString error = QString("Timed out after %1 s.").arg(call->deadlineMs / 1000);
+    if (waiting.removeOne(call)) {        // never started
+        emit call->finished(error);
+        call->deleteLater();
+    } else if (call->reply) {
+        call->reply->abort();             // finishes through onAttemptFinished
+    } else {
+        finish(call, error);              // waiting for a retry
+    }
+}
+
+void ApiClient::pump()
+{
+    while (running < maxInFlight && !waiting.isEmpty()) {
+        ApiCall *call = waiting.dequeue();
+        PerfStats::record("api.queued", call->submitNs, PerfStats::nowNs());
+        ++running;
+        start(call);
+    }
+}
+
+void ApiClient::start(ApiCall *call)
+{
+    ++call->attempt;
+    call->errorBody.clear();
+    call->attemptNs = PerfStats::nowNs();
+    call->uploaded = call->answered = false;
+
+    QNetworkRequest req(QUrl(QString("https://%1%2").arg(kHost, QString::fromLatin1(call->path))));
+    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    req.setRawHeader("Authorization", "Bearer " + apiKey);
+    req.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+
+    QNetworkReply *reply = net.post(req, call->body);
+    call->reply = reply;
+
+    // upload (request body on the wire) and time to first byte, per attempt
+    connect(reply, &QNetworkReply::uploadProgress, call, [call](qint64 sent, qint64 total) {
+        if (call->uploaded || total <= 0 || sent < total) return;
+        call->uploaded = true;
+        PerfStats::record("api.upload", call->attemptNs, PerfStats::nowNs());
+    });
+    connect(reply, &QNetworkReply::readyRead, call, [call, reply] {
+        if (!call->answered) {
+            call->answered = true;
+            PerfStats::record("api.firstByte", call->attemptNs, PerfStats::nowNs());
+        }
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status >= 200 && status < 300) {
+            call->delivered = true;
+            emit call->chunk(reply->readAll(), reply->header(QNetworkRequest::ContentTypeHeader).toByteArray());
+        } else {
+            call->errorBody += reply->readAll(); // maybe retried, don't show it
+        }
+    });
+    connect(reply, &QNetworkReply::finished, call, [this, call, reply] { onAttemptFinished(call, reply); });
+}
+
+bool ApiClient::retryable(QNetworkReply *reply, int status)
+{
+    if (status == 429 || (status >= 500 && status < 600)) return true;
+    switch (reply->error()) {
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::UnknownNetworkError:
+        return status == 0; // nothing came back
+    default:
+        return false;
+    }
+}
+
+void ApiClient::onAttemptFinished(ApiCall *call, QNetworkReply *reply)
+{
+    reply->deleteLater();
+    call->reply = nullptr;
+    PerfStats::record("api.attempt", call->attemptNs, PerfStats::nowNs());
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (call->aborted) {
+        finish(call, QString("Timed out after %1 s.").arg(call->deadlineMs / 1000));
+        return;
+    }
+    if (reply->error() == QNetworkReply::NoError) {
+        const QByteArray rest = reply->readAll();
+        if (!rest.isEmpty())
+            emit call->chunk(rest, reply->header(QNetworkRequest::ContentTypeHeader).toByteArray());
+        finish(call, QString());
+        return;
+    }
+
+    call->errorBody += reply->readAll();
+    if (!call->delivered && call->attempt <= maxRetries && retryable(reply, status)) {
+        // 0.5 s, 1 s, 2 s ... plus up to 50% jitter, or what the server asks for
+        int delayMs = 500 << (call->attempt - 1);
+        delayMs += QRandomGenerator::global()->bounded(delayMs / 2 + 1);
+        const int retryAfter = reply->rawHeader("Retry-After").toInt();
+        if (retryAfter > 0) delayMs = qMax(delayMs, retryAfter * 1000);
+
+        if (call->age.elapsed() + delayMs < call->deadlineMs) {
+            QTimer::singleShot(delayMs, call, [this, call] {
+                if (!call->aborted) start(call);
+            });
+            return;
+        }
+    }
+
+    // API errors come as {"error":{"message":...}}
+    QString error = reply->errorString();
+    const QString apiMessage = QJsonDocument::fromJson(call->errorBody).object()["error"]
+                                   .toObject()["message"].toString();
+    if (!apiMessage.isEmpty()) error = apiMessage;
+    if (status) error = QString("HTTP %1: %2").arg(status).arg(error);
+    finish(call, error);
+}
+
+void ApiClient::finish(ApiCall *call, const QString &error)
+{
+    call->deadline.stop();
+    PerfStats::record("api.total", call->submitNs, PerfStats::nowNs());
+    --running;
+    emit call->finished(error);
+    call->deleteLater();
+    pump();
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QTimer>
+
+// One logical API request. It may take several attempts (retries), but the
+// caller only sees the body of the attempt that succeeded.
+class ApiCall : public QObject {
+    Q_OBJECT
+public:
+    using QObject::QObject;
+
+    int attempts() const { return attempt; }
+
+signals:
+    void chunk(const QByteArray &data, const QByteArray &contentType);
+    void finished(const QString &error); // empty on success
+
+private:
+    friend class ApiClient;
+    QByteArray path;
+    QByteArray body;
+    int deadlineMs = 0;
+    int attempt = 0;
+    QElapsedTimer age;             // since submit, for the deadline
+    qint64 submitNs = 0;           // PerfStats clock: submit, current attempt
+    qint64 attemptNs = 0;
+    bool uploaded = false;         // this attempt: request body sent / first byte seen
+    bool answered = false;
+    QPointer<QNetworkReply> reply; // current attempt
+    QTimer deadline;               // whole request, retries included
+    QByteArray errorBody;          // body of a failed attempt
+    bool aborted = false;
+    bool delivered = false;        // caller has seen body bytes: no more retries
+};
+
+// Small client for api.openai.com on top of QNetworkAccessManager:
+// - warmUp() opens the TLS connection (ALPN h2) before the first request
+// - at most maxInFlight requests on the wire, the rest wait in a FIFO
+// - 429 / 5xx / dropped connections are retried with exponential backoff
+//   and jitter (Retry-After is honoured), within the request's deadline
+class ApiClient : public QObject {
+    Q_OBJECT
+public:
+    explicit ApiClient(QObject *parent = nullptr);
+
+    void setApiKey(const QString &key) { apiKey = key.toUtf8(); }
+    void setMaxInFlight(int n) { maxInFlight = qMax(1, n); pump(); }
+    void setMaxRetries(int n) { maxRetries = qMax(0, n); }
+
+    void warmUp();
+
+    // POST JSON to path (e.g. "/v1/chat/completions"). The call deletes
+    // itself after finished().
+    ApiCall *post(const QByteArray &path, const QJsonObject &body, int deadlineMs = 60000);
+
+    int inFlight() const { return running; }
+    int queued() const { return waiting.size(); }
+
+private:
+    void pump();
+    void start(ApiCall *call);
+    void onAttemptFinished(ApiCall *call, QNetworkReply *reply);
+    void finish(ApiCall *call, const QString &error);
+    void timeout(ApiCall *call);
+    static bool retryable(QNetworkReply *reply, int status);
+
+    QNetworkAccessManager net;
+    QByteArray apiKey;
+    QQueue<ApiCall *> waiting;
+    int running = 0;
+    int maxInFlight = 2;
+    int maxRetries = 3;
+};
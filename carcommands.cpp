@@ -0,0 +1,82 @@
+#include "carcommands.h"
+
+#include <QStringList>
+
+// clockwise order, so (to - from) mod 4 tells the turn
+static int headingIndex(char dir)
+{
+    switch (dir) {
+    case 'N': return 0;
+    case 'E': return 1;
+    case 'S': return 2;
+    case 'W': return 3;
+    }
+    return -1;
+}
+
+QVector<CarCommand> movesToCommands(const QVector<MazeMove> &moves, char startHeading)
+{
+    QVector<CarCommand> out;
+    out.reserve(moves.size() * 2 + 2);
+    int heading = headingIndex(startHeading);
+    for (const MazeMove &m : moves) {
+        const int h = headingIndex(m.dir);
+        if (h < 0 || m.steps <= 0) continue;
+        if (heading >= 0) {
+            switch ((h - heading + 4) % 4) {
+            case 1: out.append({CarCommand::TurnRight, 0}); break;
+            case 2: out.append({CarCommand::TurnRight, 0}); out.append({CarCommand::TurnRight, 0}); break;
+            case 3: out.append({CarCommand::TurnLeft, 0}); break;
+            default: break;
+            }
+        }
+        heading = h;
+
+        // merge with a FORWARD right before (same heading twice in a row)
+        int steps = m.steps;
+        if (!out.isEmpty() && out.last().op == CarCommand::Forward) {
+            const int room = 0xffff - out.last().cells;
+            const int add = qMin(room, steps);
+            out.last().cells += quint16(add);
+            steps -= add;
+        }
+        for (; steps > 0; steps -= 0xffff)
+            out.append({CarCommand::Forward, quint16(qMin(steps, 0xffff))});
+    }
+    return out;
+}
+
+QPoint applyCommands(const QPoint &cell, char &heading, const QVector<CarCommand> &commands, int count)
+{
+    static const char names[4] = {'N', 'E', 'S', 'W'};
+    static const QPoint steps[4] = {QPoint(0, -1), QPoint(1, 0), QPoint(0, 1), QPoint(-1, 0)};
+    int h = headingIndex(heading);
+    if (h < 0) return cell;
+    QPoint p = cell;
+    for (int i = 0; i < qMin(count, int(commands.size())); ++i) {
+        switch (commands[i].op) {
+        case CarCommand::Forward:   p += steps[h] * commands[i].cells; break;
+        case CarCommand::TurnLeft:  h = (h + 3) % 4; break;
+        case CarCommand::TurnRight: h = (h + 1) % 4; break;
+        case CarCommand::Stop:      break;
+        }
+    }
+    heading = names[h];
+    return p;
+}
+
+QString commandsToText(const QVector<CarCommand> &commands, const QString &separator)
+{
+    QStringList lines;
+    lines.reserve(commands.size());
+    for (int i = 0; i < commands.size(); ++i) {
+        const CarCommand &c = commands[i];
+        switch (c.op) {
+        case CarCommand::Forward:   lines << QString("%1. FORWARD %2").arg(i + 1).arg(c.cells); break;
+        case CarCommand::TurnLeft:  lines << QString("%1. TURN LEFT").arg(i + 1); break;
+        case CarCommand::TurnRight: lines << QString("%1. TURN RIGHT").arg(i + 1); break;
+        case CarCommand::Stop:      lines << QString("%1. STOP").arg(i + 1); break;
+        }
+    }
+    return lines.join(separator);
+}
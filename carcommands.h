@@ -0,0 +1,27 @@
+#pragma once
+#include <QPoint>
+#include <QString>
+#include <QVector>
+
+#include "mazepipeline.h"
+
+// Driving command for the car, relative to its current heading
+struct CarCommand {
+    enum Op : quint8 { Stop = 0, Forward = 1, TurnLeft = 2, TurnRight = 3 };
+    Op op;
+    quint16 cells;   // Forward only
+};
+
+// Run-length compass moves -> FORWARD n / TURN LEFT / TURN RIGHT.
+// heading is where the car faces ('N', 'E', 'S' or 'W'); 0 means it already
+// faces the first move (it enters the maze through the entrance). A U-turn
+// becomes two right turns. Long runs are split so every FORWARD fits in
+// 16 bits.
+QVector<CarCommand> movesToCommands(const QVector<MazeMove> &moves, char heading = 0);
+
+// Cell the car reaches after the first count commands, starting at cell
+// facing heading ('N', 'E', 'S' or 'W'); heading is turned along
+QPoint applyCommands(const QPoint &cell, char &heading, const QVector<CarCommand> &commands, int count);
+
+// "1. FORWARD 5\n2. TURN LEFT\n..." for the chat window
+QString commandsToText(const QVector<CarCommand> &commands, const QString &separator = "\n");
@@ -0,0 +1,184 @@
+#include "carlink.h"
+#include "sensorparser.h"
+
+#include <QUdpSocket>
+#include <QtEndian>
+#include <QtSerialPort/QSerialPort>
+
+static const uchar kSync = 0xC3;
+enum : quint8 { kPlan = 0x01, kStop = 0x02, kAck = 0x81, kProgress = 0x82, kPosition = 0x83 };
+static const int kPerFrame = 32;
+static const int kMaxTries = 10;
+
+CarLink::CarLink(QObject *parent)
+    : QObject(parent)
+{
+    retransmit.setInterval(200);
+    connect(&retransmit, &QTimer::timeout, this, [this] {
+        if (!ready()) return;   // still resolving: nothing was sent, nothing to count
+        if (++tries > kMaxTries) {
+            retransmit.stop();
+            emit linkError("The car did not acknowledge plan " + QString::number(planId) + ".");
+            return;
+        }
+        sendPending();
+    });
+}
+
+CarLink::~CarLink()
+{
+    close();
+}
+
+bool CarLink::open(const QString &target, QString *error)
+{
+    close();
+    if (target.startsWith("udp:", Qt::CaseInsensitive)) {
+        const int colon = target.lastIndexOf(':');
+        const QString host = target.mid(4, colon - 4);
+        const quint16 port = quint16(target.mid(colon + 1).toUInt());
+        auto *udp = new QUdpSocket(this);
+        udp->connectToHost(host, port); // resolves in the background
+        // whatever was asked for meanwhile goes out once the host is known
+        connect(udp, &QAbstractSocket::connected, this, &CarLink::sendPending);
+        dev = udp;
+    } else {
+        const QStringList parts = target.split('@');
+        auto *serial = new QSerialPort(parts.value(0), this);
+        serial->setBaudRate(parts.value(1, "115200").toInt());
+        if (!serial->open(QIODevice::ReadWrite)) {
+            if (error) *error = serial->errorString();
+            delete serial;
+            return false;
+        }
+        dev = serial;
+    }
+    targetName = target;
+    connect(dev, &QIODevice::readyRead, this, &CarLink::onReadyRead);
+    return true;
+}
+
+void CarLink::close()
+{
+    retransmit.stop();
+    delete dev;
+    dev = nullptr;
+    rx.clear();
+}
+
+QByteArray CarLink::frame(quint8 type, const QByteArray &payload)
+{
+    QByteArray f;
+    f.reserve(payload.size() + 4);
+    f.append(char(kSync));
+    f.append(char(type));
+    f.append(char(payload.size()));
+    f.append(payload);
+    f.append(char(SensorParser::crc8(reinterpret_cast<const uchar *>(f.constData()) + 1, f.size() - 1)));
+    return f;
+}
+
+bool CarLink::ready() const
+{
+    const auto *socket = qobject_cast<const QAbstractSocket *>(dev);
+    return dev && (!socket || socket->state() == QAbstractSocket::ConnectedState);
+}
+
+quint8 CarLink::sendPlan(const QVector<CarCommand> &commands)
+{
+    plan = commands;
+    planId = quint8(planId + 1 == 0 ? 1 : planId + 1); // 0 means "no plan"
+    acked = 0;
+    stopPending = false;
+    tries = 0;
+    if (plan.isEmpty()) {
+        // nothing to drive and nothing the car could acknowledge
+        retransmit.stop();
+        emit planAcked(planId, 0);
+        return planId;
+    }
+    sendPending();
+    retransmit.start();
+    return planId;
+}
+
+void CarLink::stop()
+{
+    plan.clear();
+    acked = 0;
+    stopPending = true;
+    tries = 0;
+    sendPending();
+    retransmit.start();
+}
+
+void CarLink::sendPending()
+{
+    if (!ready()) return;
+    if (stopPending) {
+        dev->write(frame(kStop, QByteArray()));
+        return;
+    }
+    // everything from the first unacknowledged command on
+    for (int first = acked; first < plan.size(); first += kPerFrame) {
+        const int n = qMin(kPerFrame, int(plan.size()) - first);
+        QByteArray payload(6 + 3 * n, '\0');
+        uchar *p = reinterpret_cast<uchar *>(payload.data());
+        p[0] = planId;
+        qToLittleEndian<quint16>(quint16(first), p + 1);
+        qToLittleEndian<quint16>(quint16(plan.size()), p + 3);
+        p[5] = uchar(n);
+        for (int i = 0; i < n; ++i) {
+            p[6 + 3 * i] = plan[first + i].op;
+            qToLittleEndian<quint16>(plan[first + i].cells, p + 7 + 3 * i);
+        }
+        dev->write(frame(kPlan, payload));
+    }
+}
+
+void CarLink::onReadyRead()
+{
+    rx += dev->readAll();
+    for (;;) {
+        const int start = rx.indexOf(char(kSync));
+        if (start < 0) { rx.clear(); return; }
+        rx.remove(0, start);
+        if (rx.size() < 4) return;
+        const int len = uchar(rx[2]);
+        if (rx.size() < 4 + len) return;
+        const uchar crc = SensorParser::crc8(reinterpret_cast<const uchar *>(rx.constData()) + 1, 2 + len);
+        if (crc != uchar(rx[3 + len])) { rx.remove(0, 1); continue; } // resync
+        handleFrame(quint8(rx[1]), rx.mid(3, len));
+        rx.remove(0, 4 + len);
+    }
+}
+
+void CarLink::handleFrame(quint8 type, const QByteArray &payload)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(payload.constData());
+    if (type == kPosition) {
+        if (payload.size() >= 5)
+            emit position(QPoint(qFromLittleEndian<quint16>(p), qFromLittleEndian<quint16>(p + 2)), char(p[4]));
+        return;
+    }
+    if (payload.size() < 3) return;
+    const quint8 id = p[0];
+    const int count = qFromLittleEndian<quint16>(p + 1);
+
+    if (type == kAck) {
+        if (stopPending && id == 0) { // car stopped and dropped its plan
+            stopPending = false;
+            retransmit.stop();
+            return;
+        }
+        if (id != planId || count <= acked) return; // old plan or duplicate
+        acked = qMin(count, int(plan.size()));
+        tries = 0;
+        if (acked == plan.size()) {
+            retransmit.stop();
+            emit planAcked(planId, acked);
+        }
+    } else if (type == kProgress && id == planId) {
+        emit progress(id, count, plan.size());
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <QByteArray>
+#include <QObject>
+#include <QPoint>
+#include <QTimer>
+#include <QVector>
+
+#include "carcommands.h"
+
+class QIODevice;
+
+// Binary command stream to the car, over a serial port or UDP.
+// Frame: 0xC3, type, payload length, payload, CRC-8 (poly 0x07) of
+// type + length + payload. Multi-byte fields are little endian.
+//   PLAN     0x01  plan id, first index (u16), total (u16), count (u8),
+//                  count x (op u8, cells u16)       at most 32 per frame
+//   STOP     0x02  -
+//   ACK      0x81  plan id, commands received in order (u16)
+//   PROGRESS 0x82  plan id, commands finished (u16)
+//   POSITION 0x83  cell x (u16), cell y (u16), heading ('N','E','S','W')
+//                  sent by the car after a localization correction
+// A PLAN with a new plan id replaces whatever the car has left: it finishes
+// the command it is driving and continues with the new plan.
+// Unacknowledged frames are sent again every 200 ms, up to 10 times.
+class CarLink : public QObject {
+    Q_OBJECT
+public:
+    explicit CarLink(QObject *parent = nullptr);
+    ~CarLink();
+
+    // "udp:<host>:<port>" or a serial port name, optionally "COM4@115200"
+    bool open(const QString &target, QString *error = nullptr);
+    void close();
+    bool isOpen() const { return dev != nullptr; }
+    QString target() const { return targetName; }
+
+    // returns the plan id
+    quint8 sendPlan(const QVector<CarCommand> &commands);
+    void stop();
+
+    static QByteArray frame(quint8 type, const QByteArray &payload);
+
+signals:
+    void planAcked(quint8 planId, int commands);
+    void progress(quint8 planId, int done, int total);
+    void position(const QPoint &cell, char heading);
+    void linkError(const QString &message);
+
+private:
+    void sendPending();
+    bool ready() const;     // open, and for UDP the host is resolved
+    void onReadyRead();
+    void handleFrame(quint8 type, const QByteArray &payload);
+
+    QIODevice *dev = nullptr;
+    QString targetName;
+
+    QVector<CarCommand> plan;
+    quint8 planId = 0;
+    int acked = 0;          // commands the car confirmed
+    bool stopPending = false;
+    int tries = 0;
+    QTimer retransmit;
+    QByteArray rx;
+};
@@ -0,0 +1,238 @@
+#include "chatmemory.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+static const int kMessageOverhead = 4; // role + framing per message
+static const int kKeepTurns = 2;       // never evict the latest exchange
+static const int kSummaryChars = 120;  // length of one summary line
+static const int kImageTokens = 800;   // roughly a 1024px image in the vision models
+
+ChatMemory::ChatMemory(const QString &path, int tokenBudget)
+    : path(path), budget(tokenBudget), summaryBudget(tokenBudget / 5)
+{
+}
+
+int ChatMemory::estimateTokens(const QString &text)
+{
+    return kMessageOverhead + (text.size() + 3) / 4;
+}
+
+int ChatMemory::turnTokens(const Turn &t)
+{
+    int n = estimateTokens(t.content);
+    if (!t.imageUrl.isEmpty()) n += kImageTokens;
+    else if (!t.imageRef.isEmpty()) n += 8;
+    return n;
+}
+
+QJsonObject ChatMemory::record(const Turn &t)
+{
+    QJsonObject rec{{"role", t.role}, {"content", t.content}};
+    if (!t.imageRef.isEmpty()) rec["image"] = t.imageRef; // never the pixels
+    return rec;
+}
+
+bool ChatMemory::load(const QString &legacyJsonPath)
+{
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        while (!file.atEnd()) {
+            const QByteArray line = file.readLine().trimmed();
+            if (line.isEmpty()) continue;
+            ++linesOnDisk;
+            const QJsonObject rec = QJsonDocument::fromJson(line).object();
+            const QString role = rec["role"].toString();
+            const QString content = rec["content"].toString();
+            if (role == "summary") {
+                summary.append(content);
+                summaryTokens += estimateTokens(content);
+            } else if (role == "user" || role == "assistant") {
+                Turn t;
+                t.role = role;
+                t.content = content;
+                t.imageRef = rec["image"].toString();
+                addTurn(t);
+            }
+        }
+    } else if (!legacyJsonPath.isEmpty()) {
+        // old format: whole conversation as one indented JSON array
+        QFile legacy(legacyJsonPath);
+        if (legacy.open(QIODevice::ReadOnly)) {
+            const QJsonArray arr = QJsonDocument::fromJson(legacy.readAll()).array();
+            for (const QJsonValue &v : arr) {
+                const QJsonObject m = v.toObject();
+                Turn t;
+                t.role = m["role"].toString();
+                t.content = m["content"].toString();
+                if (t.role == "user" || t.role == "assistant")
+                    addTurn(t);
+            }
+        }
+        if (!turns.isEmpty()) compact();
+    }
+    return !turns.isEmpty() || !summary.isEmpty();
+}
+
+int ChatMemory::indexOf(qint64 id) const
+{
+    for (int i = 0; i < turns.size(); ++i)
+        if (turns[i].id == id) return i;
+    return -1;
+}
+
+void ChatMemory::addTurn(const Turn &t, int at)
+{
+    Turn turn = t;
+    turn.tokens = turnTokens(turn);
+    liveTokens += turn.tokens;
+    if (at < 0) turns.append(turn);
+    else turns.insert(at, turn);
+    evict();
+}
+
+qint64 ChatMemory::ask(const QString &content, const QString &imageDataUrl)
+{
+    Turn t;
+    t.role = "user";
+    t.content = content;
+    t.imageUrl = imageDataUrl;
+    if (!imageDataUrl.isEmpty())
+        t.imageRef = QString::fromLatin1(QCryptographicHash::hash(imageDataUrl.toLatin1(),
+                                                                  QCryptographicHash::Sha1).toHex().left(12));
+    t.id = nextId++;
+    t.pending = true;
+    addTurn(t);
+    return t.id;
+}
+
+void ChatMemory::answer(qint64 question, const QString &content)
+{
+    Turn reply;
+    reply.role = "assistant";
+    reply.content = content;
+
+    const int q = indexOf(question);
+    if (q < 0) { // question already evicted
+        addTurn(reply);
+        writeRecords({record(reply)});
+        return;
+    }
+
+    // the model has seen the image now: keep only its reference
+    Turn &t = turns[q];
+    t.pending = false;
+    t.imageUrl.clear();
+    liveTokens -= t.tokens;
+    t.tokens = turnTokens(t);
+    liveTokens += t.tokens;
+    const QJsonObject asked = record(t);
+
+    addTurn(reply, q + 1);
+    writeRecords({asked, record(reply)}); // the pair stays together on disk
+}
+
+void ChatMemory::forget(qint64 question)
+{
+    const int q = indexOf(question);
+    if (q < 0) return;
+    liveTokens -= turns[q].tokens;
+    turns.remove(q);
+}
+
+void ChatMemory::evict()
+{
+    const int fixed = systemPrompt.isEmpty() ? 0 : estimateTokens(systemPrompt);
+    while (fixed + summaryTokens + liveTokens > budget) {
+        // oldest answered turn, never one of the last kKeepTurns
+        int i = 0;
+        while (i < turns.size() && turns[i].pending) ++i;
+        if (i >= turns.size() - kKeepTurns) break;
+
+        const Turn old = turns.takeAt(i);
+        liveTokens -= old.tokens;
+
+        QString note = old.content.simplified();
+        if (note.size() > kSummaryChars)
+            note = note.left(kSummaryChars) + "...";
+        note = old.role + ": " + note;
+        if (!old.imageRef.isEmpty()) note += " [image " + old.imageRef + "]";
+        summary.append(note);
+        summaryTokens += estimateTokens(note);
+
+        while (summaryTokens > summaryBudget && !summary.isEmpty())
+            summaryTokens -= estimateTokens(summary.takeFirst());
+    }
+}
+
+int ChatMemory::tokenCount() const
+{
+    int n = liveTokens;
+    if (!systemPrompt.isEmpty()) n += estimateTokens(systemPrompt);
+    if (!summary.isEmpty()) n += summaryTokens;
+    return n;
+}
+
+QJsonArray ChatMemory::requestMessages(qint64 question) const
+{
+    QJsonArray out;
+    if (!systemPrompt.isEmpty())
+        out.append(QJsonObject{{"role", "system"}, {"content", systemPrompt}});
+    if (!summary.isEmpty())
+        out.append(QJsonObject{{"role", "system"},
+                               {"content", "Earlier in this conversation (summary):\n" + summary.join('\n')}});
+    for (const Turn &t : turns) {
+        if (t.pending && t.id != question) continue; // someone else's question
+        if (!t.imageUrl.isEmpty()) {
+            // text + image parts, only while the image waits for its reply
+            QJsonArray parts;
+            parts.append(QJsonObject{{"type", "text"}, {"text", t.content}});
+            parts.append(QJsonObject{{"type", "image_url"}, {"image_url", QJsonObject{{"url", t.imageUrl}}}});
+            out.append(QJsonObject{{"role", t.role}, {"content", parts}});
+        } else if (!t.imageRef.isEmpty()) {
+            out.append(QJsonObject{{"role", t.role},
+                                   {"content", t.content + "\n[image " + t.imageRef
+                                                   + " was attached here and is described in the reply]"}});
+        } else {
+            out.append(QJsonObject{{"role", t.role}, {"content", t.content}});
+        }
+        if (t.id == question) break;
+    }
+    return out;
+}
+
+void ChatMemory::writeRecords(const QList<QJsonObject> &records)
+{
+    // rewrite once the log holds mostly evicted turns
+    if (linesOnDisk >= 64 && linesOnDisk > 3 * (turns.size() + summary.size())) {
+        compact();
+        return; // the new turns are already part of the compacted file
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) return;
+    for (const QJsonObject &rec : records) {
+        file.write(QJsonDocument(rec).toJson(QJsonDocument::Compact));
+        file.write("\n");
+        ++linesOnDisk;
+    }
+}
+
+void ChatMemory::compact()
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return;
+    int lines = 0;
+    auto put = [&](const QJsonObject &rec) {
+        file.write(QJsonDocument(rec).toJson(QJsonDocument::Compact));
+        file.write("\n");
+        ++lines;
+    };
+    for (const QString &line : summary) put(QJsonObject{{"role", "summary"}, {"content", line}});
+    for (const Turn &t : turns)
+        if (!t.pending) put(record(t));
+    if (file.commit())
+        linesOnDisk = lines;
+}
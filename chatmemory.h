@@ -0,0 +1,77 @@
+#pragma once
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Conversation memory with a token budget.
+// The system prompt is pinned; when the turns go over budget the oldest ones
+// are evicted and a one-line note of each is kept in a bounded summary.
+// On disk it is a JSON Lines log (one message per line, appended after every
+// turn) that is compacted to the live turns once it grows past a few times
+// their size, so both the request payload and the file stay bounded.
+// Images are only sent with the turn that is waiting for a reply; after that
+// the turn keeps a short hash reference and the base64 data is dropped.
+//
+// Several questions can be in flight at once: ask() returns an id, the reply
+// is filed right after its question with answer(), and requests for one
+// question leave the other unanswered ones out.
+class ChatMemory {
+public:
+    explicit ChatMemory(const QString &path, int tokenBudget = 3000);
+
+    void setSystemPrompt(const QString &prompt) { systemPrompt = prompt; }
+
+    // Replay the log (or import a legacy memory.json array). Returns false if
+    // there was nothing to load.
+    bool load(const QString &legacyJsonPath = QString());
+
+    // User turn waiting for a reply. imageDataUrl is sent with this question
+    // only. Nothing is written to disk until the question is answered.
+    qint64 ask(const QString &content, const QString &imageDataUrl = QString());
+    void answer(qint64 question, const QString &content);
+    void forget(qint64 question);     // request failed, drop the question
+
+    // system prompt, summary of evicted turns, then the answered turns and
+    // (if given) the pending question
+    QJsonArray requestMessages(qint64 question = -1) const;
+
+    int tokenCount() const;       // estimate of the whole memory
+    int turnCount() const { return turns.size(); }
+
+    // ~4 characters per token plus per-message overhead; good enough to
+    // keep the payload bounded without shipping a tokenizer
+    static int estimateTokens(const QString &text);
+
+private:
+    struct Turn {
+        QString role, content;
+        QString imageUrl;         // pending image, cleared once answered
+        QString imageRef;         // short content hash of the image
+        int tokens = 0;
+        qint64 id = -1;
+        bool pending = false;     // question without an answer yet
+    };
+
+    static int turnTokens(const Turn &t);
+    static QJsonObject record(const Turn &t);
+
+    int indexOf(qint64 id) const;
+    void addTurn(const Turn &t, int at = -1);
+    void evict();
+    void writeRecords(const QList<QJsonObject> &records);
+    void compact();
+
+    QString path;
+    int budget;
+    int summaryBudget;            // part of budget reserved for the summary
+    QString systemPrompt;
+    QVector<Turn> turns;
+    int liveTokens = 0;
+    qint64 nextId = 1;
+    QStringList summary;          // one line per evicted turn
+    int summaryTokens = 0;
+    int linesOnDisk = 0;
+};
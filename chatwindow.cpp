@@ -1,4 +1,12 @@
 #include "chatwindow.h"
+#include "mazegrid.h"
+#include "mazesolver.h"
+#include "sseparser.h"
+#include "imageencoder.h"
+#include "carcommands.h"
+#include "perfstats.h"
+#include "scenegate.h"
+#include <QtConcurrent/QtConcurrent>
 
 #include <QVBoxLayout>
 #include <QWidget>
@@ -8,9 +16,13 @@
 #include <QFileDialog>
 #include <QBuffer>
 #include <QDateTime>
-#include <QDebug>
 #include <QPainter>
-#include <queue>
+#include <QPainterPath>
+#include <QResizeEvent>
+#include <QScrollBar>
+#include <QStatusBar>
+#include <QTextBlock>
+#include <QTextCursor>
 #include <algorithm>
 #include <cmath>
 #include <QRegularExpression>
@@ -53,216 +65,35 @@ static QString extractJsonObject(QString s)
     return s;
 }
 
-static QRect findMazeBBox(const QImage &img, int wallLum = 200, int pad = 2)
-{
-    int minx = img.width(), miny = img.height(), maxx = -1, maxy = -1;
-    for (int y = 0; y < img.height(); ++y) {
-        const QRgb *row = reinterpret_cast<const QRgb*>(img.constScanLine(y));
-        for (int x = 0; x < img.width(); ++x) {
-            const QRgb c = row[x];
-            int lum = int(0.2126*qRed(c) + 0.7152*qGreen(c) + 0.0722*qBlue(c));
-            if (lum < wallLum) { // dark -> part of wall/frame
-                if (x < minx) minx = x;
-                if (y < miny) miny = y;
-                if (x > maxx) maxx = x;
-                if (y > maxy) maxy = y;
-            }
-        }
-    }
-    if (maxx < 0) return QRect(0,0,img.width(), img.height()); // fallback
-    minx = qMax(0, minx - pad);
-    miny = qMax(0, miny - pad);
-    maxx = qMin(img.width()-1,  maxx + pad);
-    maxy = qMin(img.height()-1, maxy + pad);
-    return QRect(QPoint(minx,miny), QPoint(maxx,maxy));
-}
-
-// treat light pixels as free space
-static inline bool isWhite(const QImage &img, int x, int y)
-{
-    if (x < 0 || y < 0 || x >= img.width() || y >= img.height()) return false;
-    const QRgb c = img.pixel(x, y);
-    const int lum = int(0.2126*qRed(c) + 0.7152*qGreen(c) + 0.0722*qBlue(c));
-    return lum > 230; // white corridor (tweak threshold if needed)
-}
-
-// Build a coarse grid by sampling the maze image
-static void buildGrid(const QImage &maze, int cellSize,
-                      QVector<QVector<bool>> &grid)
-{
-    const int gw = (maze.width()  + cellSize - 1) / cellSize;
-    const int gh = (maze.height() + cellSize - 1) / cellSize;
-
-    grid.resize(gh);
-    for (int gy = 0; gy < gh; ++gy) {
-        grid[gy].resize(gw);
-        for (int gx = 0; gx < gw; ++gx) {
-            int x0 = gx * cellSize;
-            int y0 = gy * cellSize;
-            int x1 = qMin(x0 + cellSize, maze.width());
-            int y1 = qMin(y0 + cellSize, maze.height());
-
-            int whiteCount = 0;
-            int total = 0;
-
-            // sample every pixel in the cell
-            for (int y = y0; y < y1; ++y) {
-                for (int x = x0; x < x1; ++x) {
-                    ++total;
-                    if (isWhite(maze, x, y))
-                        ++whiteCount;
-        }
-    }
-            // require MOST of the cell to be white to be considered free
-            double ratio = (total > 0) ? (double)whiteCount / (double)total : 0.0;
-            grid[gy][gx] = (ratio > 0.7);  // >70% white → free cell
-        }
-    }
-}
-
-// Find two openings on the border of the grid
-static bool findOpenings(const QVector<QVector<bool>> &grid,
-                         QPoint &start, QPoint &goal)
-{
-    const int gh = grid.size();
-    if (gh == 0) return false;
-    const int gw = grid[0].size();
-
-    QVector<QPoint> openings;
-
-    // top and bottom
-    for (int x = 0; x < gw; ++x) {
-        if (grid[0][x])         openings.append(QPoint(x,0));
-        if (grid[gh-1][x])      openings.append(QPoint(x,gh-1));
-    }
-    // left and right
-    for (int y = 0; y < gh; ++y) {
-        if (grid[y][0])         openings.append(QPoint(0,y));
-        if (grid[y][gw-1])      openings.append(QPoint(gw-1,y));
-    }
-
-    if (openings.size() < 2) return false;
-    start = openings.front();
-    goal  = openings.back();
-    return true;
-}
-
-// BFS on grid → list of grid cells from start to goal
-static QVector<QPoint> bfsPath(const QVector<QVector<bool>> &grid,
-                               const QPoint &start, const QPoint &goal)
-{
-    const int gh = grid.size();
-    if (gh == 0) return {};
-    const int gw = grid[0].size();
-
-    auto idx = [gw](int x,int y){ return y*gw + x; };
-    QVector<int> dist(gw*gh, -1);
-    QVector<QPoint> parent(gw*gh, QPoint(-1,-1));
-
-    std::queue<QPoint> q;
-    q.push(start);
-    dist[idx(start.x(), start.y())] = 0;
-
-    const int dx[4] = {1,-1,0,0};
-    const int dy[4] = {0,0,1,-1};
-
-    while (!q.empty()) {
-        QPoint u = q.front(); q.pop();
-        if (u == goal) break;
-
-        for (int k = 0; k < 4; ++k) {
-            int nx = u.x() + dx[k];
-            int ny = u.y() + dy[k];
-            if (nx < 0 || ny < 0 || nx >= gw || ny >= gh) continue;
-            if (!grid[ny][nx]) continue;
-            int id = idx(nx,ny);
-            if (dist[id] != -1) continue;
-            dist[id] = dist[idx(u.x(),u.y())] + 1;
-            parent[id] = u;
-            q.push(QPoint(nx,ny));
-        }
-    }
-
-    if (dist[idx(goal.x(), goal.y())] == -1) {
-        return {}; // no path
-    }
-
-    QVector<QPoint> path;
-    for (QPoint v = goal; v != QPoint(-1,-1); v = parent[idx(v.x(),v.y())]) {
-        path.append(v);
-        if (v == start) break;
-    }
-    std::reverse(path.begin(), path.end());
-    return path;
-}
-
-static QString pathToMoves(const QVector<QPoint> &gridPath)
-{
-    if (gridPath.size() < 2)
-        return "{}";
-
-    struct Move { QString dir; int steps; };
-    QVector<Move> moves;
-
-    auto dirFromDelta = [](int dx, int dy)->QString {
-        if (dx == 1 && dy == 0)  return "E";
-        if (dx == -1 && dy == 0) return "W";
-        if (dx == 0 && dy == 1)  return "S";
-        if (dx == 0 && dy == -1) return "N";
-        return "?";
-    };
-
-    QPoint prev = gridPath[0];
-    QString curDir;
-    int curSteps = 0;
-
-    for (int i = 1; i < gridPath.size(); ++i) {
-        QPoint p = gridPath[i];
-        int dx = p.x() - prev.x();
-        int dy = p.y() - prev.y();
-        QString d = dirFromDelta(dx, dy);
-        if (d == "?") {
-            prev = p;
-            continue; // skip weird jumps
-        }
-        if (curSteps == 0) {
-            curDir = d;
-            curSteps = 1;
-        } else if (d == curDir) {
-            ++curSteps;
-        } else {
-            moves.push_back({curDir, curSteps});
-            curDir = d;
-            curSteps = 1;
-        }
-        prev = p;
-    }
-    if (curSteps > 0)
-        moves.push_back({curDir, curSteps});
-
-    // Build a simple JSON-like string: [{"dir":"E","steps":5}, ...]
-    QStringList parts;
-    for (const auto &m : moves) {
-        parts << QString("{\"dir\":\"%1\",\"steps\":%2}")
-        .arg(m.dir)
-            .arg(m.steps);
-    }
-    return "[" + parts.join(",") + "]";
-}
-
 ChatWindow::ChatWindow(QWidget *parent)
     : QMainWindow(parent),
-    history(new QTextEdit(this)),
+    history(new QPlainTextEdit(this)),
     input(new QLineEdit(this)),
     sendBtn(new QPushButton("Send", this)),
     sendImageBtn (new QPushButton("Send Image", this)),
+    streamBox(new QCheckBox("Stream", this)),
     preview(new QLabel(this)),
     startCamBtn(new QPushButton("Start Camera", this)),
     captureBtn(new QPushButton("Capture & Send", this)),
     stopCamBtn(new QPushButton("Stop Camera", this)),
+    liveSolveBtn(new QPushButton("Live Solve", this)),
+    autoDescribeBtn(new QPushButton("Auto Describe", this)),
+    previewStack(new QStackedWidget(this)),
+    videoView(new QGraphicsView(this)),
+    videoScene(new QGraphicsScene(this)),
+    videoItem(new QGraphicsVideoItem),
+    routeItem(new QGraphicsPathItem(videoItem)),
     guideBtn(new QPushButton("Explain Path", this)),
-    net(new QNetworkAccessManager(this)),
-    apiKey(QString::fromUtf8(qgetenv("OPENAI_API_KEY")))
+    carBtn(new QPushButton("Send to Car", this)),
+    solverBox(new QComboBox(this)),
+    smoothBox(new QCheckBox("Smooth", this)),
+    saveBox(new QComboBox(this)),
+    solveBtn(new QPushButton("Solve Maze", this)),
+    cancelSolveBtn(new QPushButton("Cancel Solve", this)),
+    api(new ApiClient(this)),
+    apiKey(QString::fromUtf8(qgetenv("OPENAI_API_KEY"))),
+    memory("memory.jsonl"),
+    cache(qEnvironmentVariable("SMARTSYSTEMS_CACHE_DIR"))
 {
     setWindowTitle("AI Chat");
     resize(720, 720);
@@ -274,19 +105,55 @@ ChatWindow::ChatWindow(QWidget *parent)
 
     history->setReadOnly(true);
     history->setPlaceholderText("Conversation will appear here...");
+    // Plain text layout only lays out the blocks in view, and the document
+    // keeps the last SMARTSYSTEMS_CHAT_ROWS entries (default 2000); no undo
+    // stack, read-only text doesn't need one
+    const int chatRows = qEnvironmentVariableIntValue("SMARTSYSTEMS_CHAT_ROWS");
+    history->setMaximumBlockCount(chatRows > 0 ? chatRows : 2000);
+    history->setUndoRedoEnabled(false);
     input->setPlaceholderText("Type your message and press Enter…");
+    streamBox->setChecked(true);
+    streamBox->setToolTip("Show replies while they are being generated");
 
     // Row with input + buttons
     auto *inputRow = new QHBoxLayout();
     inputRow->addWidget(input, 1);
     inputRow->addWidget(sendBtn);
     inputRow->addWidget(sendImageBtn);
+    inputRow->addWidget(streamBox);
     inputRow->addWidget(guideBtn);
-
-    // Solve Maze Button
-    auto *solveBtn = new QPushButton("Solve Maze", this);
+    inputRow->addWidget(carBtn);
+
+    // Solve Maze Button + solver choice
+    for (MazeSolverKind kind : {MazeSolverKind::Bfs, MazeSolverKind::BidirectionalBfs, MazeSolverKind::AStar})
+        solverBox->addItem(mazeSolverName(kind), int(kind));
+    solverBox->addItem("Compare all", -1);
+    solverBox->setToolTip("Maze solver");
+    inputRow->addWidget(solverBox);
+    smoothBox->setToolTip("Draw the route with diagonal shortcuts (the car still drives the grid route)");
+    inputRow->addWidget(smoothBox);
+    // data: "format:quality"; PNG quality trades zlib effort for file size
+    saveBox->addItem("Don't save", QString());
+    saveBox->addItem("Save PNG (fast)", "PNG:80");
+    saveBox->addItem("Save PNG (small)", "PNG:0");
+    saveBox->addItem("Save JPEG", "JPG:90");
+    saveBox->setCurrentIndex(1);
+    saveBox->setToolTip("Save the full-size solved maze to the temp folder (in the background)");
+    inputRow->addWidget(saveBox);
     inputRow->addWidget(solveBtn);
+    inputRow->addWidget(cancelSolveBtn);
+    cancelSolveBtn->setEnabled(false);
     connect(solveBtn, &QPushButton::clicked, this, &ChatWindow::solveMazeFromFile);
+    connect(cancelSolveBtn, &QPushButton::clicked, this, &ChatWindow::cancelMazeSolve);
+    connect(&mazeWatcher, &QFutureWatcher<MazeJobResult>::finished, this, &ChatWindow::onMazeSolved);
+    connect(&saveWatcher, &QFutureWatcher<QString>::finished, this, [this] {
+        const QString saved = saveWatcher.result();
+        appendToHistory("System", saved.isEmpty() ? QString("Could not save the solved maze.")
+                                                  : "Solved maze saved to: " + saved);
+    });
+    connect(&mazeWatcher, &QFutureWatcher<MazeJobResult>::progressValueChanged, this, [this](int percent) {
+        cancelSolveBtn->setText(QString("Cancel Solve (%1%)").arg(percent));
+    });
 
     // Camera preview + controls
     preview->setMinimumHeight(240);
@@ -297,10 +164,32 @@ ChatWindow::ChatWindow(QWidget *parent)
     camRow->addWidget(startCamBtn);
     camRow->addWidget(captureBtn);
     camRow->addWidget(stopCamBtn);
+    camRow->addWidget(liveSolveBtn);
+    camRow->addWidget(autoDescribeBtn);
+
+    // Live video: QGraphicsVideoItem paints the frames scaled to the view,
+    // the live route is a vector item on top of it.
+    videoScene->addItem(videoItem);
+    QPen routePen(Qt::red, 3, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+    routePen.setCosmetic(true); // width in screen pixels, whatever the zoom
+    routeItem->setPen(routePen);
+    videoView->setScene(videoScene);
+    videoView->setMinimumHeight(240);
+    videoView->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    videoView->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    videoView->setStyleSheet("border:1px solid #444; border-radius:8px; background:black;");
+    connect(videoItem, &QGraphicsVideoItem::nativeSizeChanged, this, [this](const QSizeF &size) {
+        videoItem->setSize(size);          // item coordinates == frame pixels
+        videoScene->setSceneRect(videoItem->boundingRect());
+        fitPreview();
+    });
+
+    previewStack->addWidget(preview);
+    previewStack->addWidget(videoView);
 
     layout->addWidget(history);
     layout->addLayout(inputRow);
-    layout->addWidget(preview);
+    layout->addWidget(previewStack);
     layout->addLayout(camRow);
 
 
@@ -309,37 +198,94 @@ ChatWindow::ChatWindow(QWidget *parent)
     connect(input, &QLineEdit::returnPressed, this, &ChatWindow::sendCurrentInput);
     connect(sendImageBtn, &QPushButton::clicked, this, &ChatWindow::sendImage);
     connect(guideBtn, &QPushButton::clicked, this, &ChatWindow::explainMazePath);
+    connect(carBtn, &QPushButton::clicked, this, &ChatWindow::sendPathToCar);
+
+    // Car link. Distance readings are mapped onto the grid only once the
+    // maze's real width is known: SMARTSYSTEMS_MAZE_WIDTH_CM
+    mazeWidthCm = qMax(0.0, qEnvironmentVariable("SMARTSYSTEMS_MAZE_WIDTH_CM").toDouble());
+    connect(&car, &CarLink::planAcked, this, [this](quint8 planId, int commands) {
+        appendToHistory("System", QString("Car received plan %1 (%2 commands).").arg(planId).arg(commands));
+    });
+    connect(&car, &CarLink::progress, this, &ChatWindow::onCarProgress);
+    connect(&car, &CarLink::position, this, &ChatWindow::onCarPosition);
+    connect(&car, &CarLink::linkError, this, [this](const QString &message) {
+        appendToHistory("Error", message);
+    });
 
     // Camera signals
     connect(startCamBtn, &QPushButton::clicked, this, &ChatWindow::startCamera);
     connect(stopCamBtn,  &QPushButton::clicked, this, &ChatWindow::stopCamera);
     connect(captureBtn,  &QPushButton::clicked, this, &ChatWindow::captureAndSend);
-
+    connect(liveSolveBtn, &QPushButton::toggled, this, &ChatWindow::toggleLiveSolve);
+    connect(&liveWatcher, &QFutureWatcher<MazeJobResult>::finished, this, &ChatWindow::onLiveSolved);
+    connect(autoDescribeBtn, &QPushButton::toggled, this, &ChatWindow::toggleAutoDescribe);
+    connect(&autoTimer, &QTimer::timeout, this, &ChatWindow::autoDescribeTick);
+
+    // Auto describe: look every SMARTSYSTEMS_AUTO_DESCRIBE_MS (default 2 s),
+    // upload at least every SMARTSYSTEMS_AUTO_DESCRIBE_MAX_S (default 60 s)
+    const int autoMs = qEnvironmentVariableIntValue("SMARTSYSTEMS_AUTO_DESCRIBE_MS");
+    autoTimer.setInterval(autoMs > 0 ? autoMs : 2000);
+    const int autoMaxS = qEnvironmentVariableIntValue("SMARTSYSTEMS_AUTO_DESCRIBE_MAX_S");
+    sceneGate.setMaxIntervalMs(1000LL * (autoMaxS > 0 ? autoMaxS : 60));
+    autoDescribeBtn->setCheckable(true);
+    autoDescribeBtn->setEnabled(false);
+    autoDescribeBtn->setToolTip("Describe the scene whenever the camera sees it change");
+
+    liveSolveBtn->setCheckable(true);
     captureBtn->setEnabled(false);
     stopCamBtn->setEnabled(false);
+    liveSolveBtn->setEnabled(false);
 
     if (apiKey.isEmpty())
         appendToHistory("System", "OPENAI_API_KEY not set. Set it in your environment for development.");
 
-    conversationHistory = QJsonArray{
-        QJsonObject{{"role", "system"},
-                {"content", "You are a helpful assistant inside a Qt chat window. "
-                                "Remember the conversation history and respond naturally."}}};
-
-    // Try loading memory from disk
-    QFile memFile("memory.json");
-    if (memFile.open(QIODevice::ReadOnly)) {
-        QByteArray data = memFile.readAll();
-        QJsonDocument doc = QJsonDocument::fromJson(data);
-        if (doc.isArray()) {
-            conversationHistory = doc.array();
-            appendToHistory("System", "(Loaded previous memory)");
-        }
-    }
+    // open the TLS connection now so the first question doesn't pay for it
+    api->setApiKey(apiKey);
+    api->setMaxInFlight(2);   // e.g. a scene description and a maze explanation
+    if (!apiKey.isEmpty())
+        api->warmUp();
+
+    memory.setSystemPrompt("You are a helpful assistant inside a Qt chat window. "
+                           "Remember the conversation history and respond naturally.");
+
+    // Try loading memory from disk (memory.json is the old format)
+    if (memory.load("memory.json"))
+        appendToHistory("System", QString("(Loaded previous memory, ~%1 tokens)").arg(memory.tokenCount()));
+}
+
+ChatWindow::~ChatWindow() {
+    // the job owns copies of its inputs; just don't leave it running
+    mazeWatcher.cancel();
+    liveWatcher.cancel();
+    mazeWatcher.waitForFinished();
+    liveWatcher.waitForFinished();
+}
+
+// Tags a history block with its entry number
+struct HistoryEntryData : QTextBlockUserData {
+    explicit HistoryEntryData(qint64 entry) : entry(entry) {}
+    qint64 entry;
+};
+
+qint64 ChatWindow::appendToHistory(const QString &speaker, const QString &text) {
+    PerfScope scope("chat.append");
+    // <br> stays inside the block, so every entry is exactly one block
+    QString html = text.toHtmlEscaped();
+    html.replace('\n', "<br>");
+    history->appendHtml(QString("<b>%1:</b> %2").arg(speaker, html));
+    const qint64 entry = historyEntries++;
+    history->document()->lastBlock().setUserData(new HistoryEntryData(entry));
+    return entry;
 }
 
-void ChatWindow::appendToHistory(const QString &speaker, const QString &text) {
-    history->append(QString("<b>%1:</b> %2").arg(speaker, text.toHtmlEscaped()));
+QTextBlock ChatWindow::historyEntry(qint64 entry) const {
+    // the document holds the newest blockCount() entries
+    const QTextDocument *doc = history->document();
+    const qint64 number = entry - (historyEntries - doc->blockCount());
+    if (number < 0 || number >= doc->blockCount()) return QTextBlock();
+    const QTextBlock block = doc->findBlockByNumber(int(number));
+    auto *data = static_cast<HistoryEntryData *>(block.userData());
+    return data && data->entry == entry ? block : QTextBlock();
 }
 
 
@@ -349,38 +295,44 @@ void ChatWindow::startCamera() {
     if (camera) return;
 
     camera = new QCamera(this);
-    videoSink = new QVideoSink(this);
 
+    // Frames go straight to the video item, which scales them while painting;
+    // we only keep a reference to the latest frame and convert it on demand.
     captureSession.setCamera(camera);
-    captureSession.setVideoSink(videoSink);
+    captureSession.setVideoOutput(videoItem);
 
-    connect(videoSink, &QVideoSink::videoFrameChanged,
-            this, &ChatWindow::onNewVideoFrame);
+    connect(videoItem->videoSink(), &QVideoSink::videoFrameChanged,
+            this, &ChatWindow::onNewVideoFrame, Qt::UniqueConnection);
 
     camera->start();
+    previewStack->setCurrentWidget(videoView);
 
     appendToHistory("System", "Camera started.");
     captureBtn->setEnabled(true);
     stopCamBtn->setEnabled(true);
+    liveSolveBtn->setEnabled(true);
+    autoDescribeBtn->setEnabled(!apiKey.isEmpty());
     startCamBtn->setEnabled(false);
 }
 
 void ChatWindow::stopCamera() {
     if (!camera) return;
     camera->stop();
+    captureSession.setCamera(nullptr);
     camera->deleteLater();
     camera = nullptr;
 
-    if (videoSink) {
-        videoSink->deleteLater();
-        videoSink = nullptr;
-    }
-    lastFrame = QImage();
+    lastVideoFrame = QVideoFrame();
 
     preview->clear();
     preview->setText("Camera stopped.");
+    previewStack->setCurrentWidget(preview);
     appendToHistory("System", "Camera stopped.");
 
+    liveSolveBtn->setChecked(false);
+    liveSolveBtn->setEnabled(false);
+    autoDescribeBtn->setChecked(false);
+    autoDescribeBtn->setEnabled(false);
     captureBtn->setEnabled(false);
     stopCamBtn->setEnabled(false);
     startCamBtn->setEnabled(true);
@@ -388,37 +340,203 @@ void ChatWindow::stopCamera() {
 
 void ChatWindow::onNewVideoFrame(const QVideoFrame &frame) {
     if (!frame.isValid()) return;
-    QVideoFrame f(frame);
-    if (!f.map(QVideoFrame::ReadOnly)) return;
-    QImage img = f.toImage();   // Qt converts to QImage
-    f.unmap();
-
-    if (!img.isNull()) {
-        lastFrame = img;
-        // show scaled preview
-        preview->setPixmap(QPixmap::fromImage(img).scaled(
-            preview->size()*devicePixelRatioF(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    lastVideoFrame = frame;   // shared, no pixel copy
+    PerfStats::count("camera.frames");
+
+    if (liveSolveBtn->isChecked())
+        maybeStartLiveSolve();
+}
+
+QImage ChatWindow::currentFrame() const {
+    // the only place camera pixels are converted to a QImage
+    PerfScope scope("camera.toImage");
+    return lastVideoFrame.isValid() ? lastVideoFrame.toImage() : QImage();
+}
+
+void ChatWindow::fitPreview() {
+    if (!videoItem->size().isEmpty())
+        videoView->fitInView(videoItem, Qt::KeepAspectRatio);
+}
+
+void ChatWindow::resizeEvent(QResizeEvent *event) {
+    QMainWindow::resizeEvent(event);
+    fitPreview();
+}
+
+void ChatWindow::showPreviewImage(const QImage &img) {
+    // solved mazes already come at preview size; only scale what is bigger
+    const qreal dpr = devicePixelRatioF();
+    const QSize target = preview->size()*dpr;
+    QPixmap pix = QPixmap::fromImage(img);
+    if (pix.width() > target.width() || pix.height() > target.height())
+        pix = pix.scaled(target, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    pix.setDevicePixelRatio(dpr);
+    preview->setPixmap(pix);
+    previewStack->setCurrentWidget(preview);
+}
+
+/* ======== Live maze solving ======== */
+
+void ChatWindow::updateLiveRoute() {
+    // route item is a child of the video item, so it uses frame pixels
+    QPainterPath route;
+    const QVector<QPointF> pts = pathToImagePoints(livePath, liveBBox, liveCellSize);
+    if (pts.size() > 1) {
+        route.moveTo(pts.first());
+        for (int i = 1; i < pts.size(); ++i)
+            route.lineTo(pts[i]);
+    }
+    routeItem->setPath(route);
+}
+
+void ChatWindow::toggleLiveSolve(bool on) {
+    liveGridHash = 0;
+    liveCellSize = 0;
+    livePath.clear();
+    updateLiveRoute();
+    if (on) {
+        liveThrottle.invalidate();
+        previewStack->setCurrentWidget(videoView);
+        appendToHistory("System", "Live solve on: hold the maze in front of the camera.");
+    } else {
+        liveWatcher.cancel();
+        appendToHistory("System", "Live solve off.");
+    }
+}
+
+void ChatWindow::maybeStartLiveSolve() {
+    // drop the frame if a solve is still running or we solved too recently
+    if (liveWatcher.isRunning()) return;
+    if (liveThrottle.isValid() && liveThrottle.elapsed() < liveIntervalMs) return;
+    liveThrottle.start();
+
+    const QImage frame = currentFrame();
+    if (frame.isNull()) return;
+
+    MazeJobOptions opt = mazeOptionsFromUi();
+    opt.compareAll = false;
+    opt.drawOverlay = false;   // the preview draws the route itself
+    opt.previousGridHash = liveGridHash;
+    opt.previousCellSize = liveCellSize;
+
+    liveWatcher.setFuture(QtConcurrent::run([frame, opt](QPromise<MazeJobResult> &promise) {
+        MazeJobResult r = runMazePipeline(frame, opt, [&promise](int) { return !promise.isCanceled(); });
+        if (!promise.isCanceled())
+            promise.addResult(r);
+    }));
+}
+
+void ChatWindow::onLiveSolved() {
+    if (!liveSolveBtn->isChecked() || liveWatcher.isCanceled() || liveWatcher.future().resultCount() == 0)
+        return;
+
+    const MazeJobResult r = liveWatcher.result();
+    if (r.unchanged) {
+        // same maze, maybe moved in the picture: keep the route, follow the frame
+        if (r.bbox != liveBBox && !livePath.isEmpty()) {
+            liveBBox = r.bbox;
+            updateLiveRoute();
+        }
+        return;
+    }
+
+    liveGridHash = r.gridHash;
+    liveCellSize = r.cellSize;
+    liveBBox = r.bbox;
+
+    const bool hadPath = !livePath.isEmpty();
+    if (r.ok) {
+        livePath = r.smoothRoute.isEmpty() ? r.route : r.smoothRoute;
+        updateLiveRoute();
+        setSolvedMaze(r);
+        if (!hadPath)
+            appendToHistory("System", QString("Live solve: route found (%1 cells, %2 corners).")
+                                          .arg(r.gridPath.size()).arg(r.route.size()));
+    } else {
+        livePath.clear();
+        updateLiveRoute();
+        if (hadPath)
+            appendToHistory("System", "Live solve: route lost (" + r.error + ")");
     }
 }
 
 void ChatWindow::captureAndSend() {
+    const QImage lastFrame = currentFrame();
     if (lastFrame.isNull()) {
         appendToHistory("System", "No frame available. Is the camera running?");
         return;
     }
 
-    // Resize to keep payload reasonable
-    QImage scaled = lastFrame.scaled(1024, 1024, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    appendToHistory("You", "[captured a photo] Describe this scene.");
+    encodeAndPost(encoder.encode(lastFrame, ImageUse::Scene), "Describe this scene.");
+}
+
+void ChatWindow::encodeAndPost(const QFuture<EncodedImage> &job, const QString &prompt,
+                               const std::function<void(const QString &)> &onReply) {
+    // scaling + JPEG run on the encoder thread; post once the data URL is ready
+    job.then(this, [this, prompt, onReply](const EncodedImage &img) {
+        if (img.dataUrl.isEmpty()) {
+            appendToHistory("System", img.error);
+            if (onReply) onReply(QString());
+            return;
+        }
+        const QString stats = QString("Image %1x%2, %3 KB, encoded in %4 ms")
+                .arg(img.size.width()).arg(img.size.height())
+                .arg(img.bytes / 1024.0, 0, 'f', 1).arg(img.encodeUs / 1000.0, 0, 'f', 1);
+        statusBar()->showMessage(stats);
+        postImage(prompt, img.dataUrl, onReply);
+    });
+}
 
-    QByteArray bytes;
-    QBuffer buf(&bytes);
-    buf.open(QIODevice::WriteOnly);
-    scaled.save(&buf, "JPEG", 85);
-    QByteArray b64 = bytes.toBase64();
-    QString dataUrl = "data:image/jpeg;base64," + QString::fromLatin1(b64);
+/* ======== Auto describe ======== */
+
+void ChatWindow::toggleAutoDescribe(bool on) {
+    sceneGate.reset();
+    if (on) {
+        autoClock.start();
+        autoTimer.start();
+        appendToHistory("System", "Auto describe on: the scene is described again when it changes.");
+        autoDescribeTick();
+    } else {
+        autoTimer.stop();
+        appendToHistory("System", "Auto describe off.");
+    }
+}
 
-    appendToHistory("You", "[captured a photo] Describe this scene.");
-    postImage("Describe this scene.", dataUrl);
+void ChatWindow::autoDescribeTick() {
+    if (autoBusy || !autoDescribeBtn->isChecked() || !lastVideoFrame.isValid()) return;
+
+    // sampled from the mapped frame; only a frame worth sending is converted
+    PerfScope scope("scene.signature");
+    const SceneSignature sig = sceneSignature(lastVideoFrame);
+    scope.stop();
+    if (sig.isNull()) return;
+    const qint64 now = autoClock.elapsed();
+    const SceneGate::Decision d = sceneGate.check(sig, now);
+    if (!d.send) {
+        // nothing new in front of the camera: the last answer still holds
+        PerfStats::count("scene.skipped");
+        statusBar()->showMessage(QString("Scene unchanged (%1 hash bits, %2% difference), "
+                                         "the last description still applies")
+                                     .arg(d.change.hashBits).arg(d.change.meanDiff * 100, 0, 'f', 1));
+        return;
+    }
+    const QImage frame = currentFrame();
+    if (frame.isNull()) return;
+
+    PerfStats::count("scene.sent");
+    autoBusy = true;
+    const QString prompt = "Describe this scene.";
+    appendToHistory("You", QString("[auto capture, %1] %2").arg(d.reason, prompt));
+    encodeAndPost(encoder.encode(frame, ImageUse::Scene), prompt, [this, sig, now](const QString &reply) {
+        autoBusy = false;
+        if (reply.isEmpty()) {
+            // don't keep uploading into an error every few seconds
+            autoDescribeBtn->setChecked(false);
+            return;
+        }
+        sceneGate.markSent(sig, now);
+    });
 }
 
 /* ======== Existing chat/text & vision methods ======== */
@@ -432,114 +550,166 @@ void ChatWindow::sendCurrentInput() {
     postChat(userText);
 }
 
-void ChatWindow::postChat(const QString &userText) {
-// Update UI
+void ChatWindow::postChat(const QString &userText, bool selfContained) {
+// Update UI (stays usable: requests are queued and run side by side)
     appendToHistory("You", userText);
-    input->setEnabled(false);
-    sendBtn->setEnabled(false);
 
-    // Add user turn to in-memory conversation
-    conversationHistory.append(QJsonObject{
-        {"role", "user"},
-        {"content", userText}
-    });
+    // Add user turn to memory (written to memory.jsonl with its answer)
+    const qint64 question = memory.ask(userText);
 
     // ---- build request ----
-    QNetworkRequest req(QUrl("https://api.openai.com/v1/chat/completions"));
-    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    req.setRawHeader("Authorization", QString("Bearer %1").arg(apiKey).toUtf8());
+    const QJsonArray msgs = memory.requestMessages(question); // bounded by the token budget
+    requestCompletion(msgs, selfContained ? cacheContext(msgs) : msgs, [this, question](const QString &replyText) {
+        // Error fallback
+        if (replyText.isEmpty()) {
+            appendToHistory("Error", "Empty response.");
+            memory.forget(question);
+            return;
+        }
 
-    QJsonObject body;
-    body["model"] = "gpt-4o-mini";
-    body["messages"] = conversationHistory;
+        // Store in memory
+        memory.answer(question, replyText);
+    });
+
+}
 
-    auto *reply = net->post(req, QJsonDocument(body).toJson());
+// POST /v1/chat/completions, unless the cache already has the answer.
+// keyMessages is what the answer depends on (all of messages for a normal
+// chat turn, see cacheContext for self-contained prompts).
+void ChatWindow::requestCompletion(const QJsonArray &messages, const QJsonArray &keyMessages,
+                                   const std::function<void(const QString &)> &done) {
+    const QString model = "gpt-4o-mini"; // vision-capable
+    const QByteArray key = ResponseCache::key(model, keyMessages);
+
+    QString cached;
+    if (cache.lookup(key, cached)) {
+        appendToHistory("AI", cached);
+        statusBar()->showMessage(QString("Reply: from cache (%1 hits, %2 misses)")
+                                 .arg(cache.hits()).arg(cache.misses()));
+        done(cached);
+        return;
+    }
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+    QJsonObject body;
+    body["model"] = model;
+    body["messages"] = messages;
+    if (streamBox->isChecked()) body["stream"] = true;
 
-        QByteArray payload = reply->readAll();
-        reply->deleteLater();
+    // queued, retried on 429/5xx, 60 s for the whole thing
+    ApiCall *call = api->post("/v1/chat/completions", body, 60000);
+    readCompletion(call, [this, key, done](const QString &replyText) {
+        cache.insert(key, replyText);
+        done(replyText);
+    });
+}
 
-        QString replyText;
+// System prompt + the last turn: the cache key for prompts that carry all
+// their context (maze explanations, image descriptions), so they hit the
+// cache whatever was said before.
+QJsonArray ChatWindow::cacheContext(const QJsonArray &messages) {
+    QJsonArray key;
+    if (messages.size() > 1 && messages.first().toObject()["role"].toString() == "system")
+        key.append(messages.first());
+    if (!messages.isEmpty())
+        key.append(messages.last());
+    return key;
+}
 
-        // ---- Extract assistant text ----
-        QJsonDocument doc = QJsonDocument::fromJson(payload);
-        if (doc.isObject()) {
-            QJsonArray choices = doc.object()["choices"].toArray();
-            if (!choices.isEmpty()) {
-                replyText = choices[0]
-                        .toObject()["message"]
-                        .toObject()["content"].toString();
+// Streamed replies are shown token by token as they arrive; plain JSON
+// replies (stream off) are shown when finished. Each reply writes into its
+// own history entry, so concurrent replies don't mix.
+// done() gets the whole assistant text, empty on error.
+void ChatWindow::readCompletion(ApiCall *call, const std::function<void(const QString &)> &done) {
+    struct State {
+        SseParser sse;
+        QByteArray raw;         // non-streamed body
+        QString text;
+        bool streaming = false;
+        qint64 entry = -1;      // "AI:" entry of this reply, once started
+        QElapsedTimer timer;
+        qint64 firstTokenMs = -1;
+        qint64 startNs = PerfStats::nowNs();
+    };
+    auto st = std::make_shared<State>();
+    st->timer.start();
+
+    connect(call, &ApiCall::chunk, this, [this, st](const QByteArray &data, const QByteArray &type) {
+        if (!st->streaming && type.contains("event-stream"))
+            st->streaming = true;
+        if (!st->streaming) { st->raw += data; return; } // parsed when finished
+
+        for (const QByteArray &event : st->sse.feed(data)) {
+            if (event == "[DONE]") continue;
+            const QString token = completionDelta(event);
+            if (token.isEmpty()) continue;
+            if (st->entry < 0) {
+                st->firstTokenMs = st->timer.elapsed();
+                PerfStats::record("reply.firstToken", st->startNs, PerfStats::nowNs());
+                st->entry = appendToHistory("AI", QString());
             }
+            st->text += token;
+            appendToEntry(st->entry, token);
         }
+    });
 
-        // Error fallback
-        if (replyText.isEmpty()) {
-            appendToHistory("Error", "Empty response.");
-            input->setEnabled(true);
-            sendBtn->setEnabled(true);
+    connect(call, &ApiCall::finished, this, [this, st, call, done](const QString &error) {
+        if (!error.isEmpty()) {
+            appendToHistory("Error", error);
+            done(QString());
             return;
         }
 
-        // Show in chat
-        appendToHistory("AI", replyText);
-
-        // Store in memory
-        conversationHistory.append(QJsonObject{
-            {"role", "assistant"},
-            {"content", replyText}
-        });
-
-        // ---- Persist memory to disk ----
-        QFile memFile("memory.json");
-        if (memFile.open(QIODevice::WriteOnly)) {
-            memFile.write(QJsonDocument(conversationHistory)
-                          .toJson(QJsonDocument::Indented));
+        if (!st->streaming) {
+            // ---- Extract assistant text ----
+            QJsonDocument doc = QJsonDocument::fromJson(st->raw);
+            if (doc.isObject()) {
+                QJsonArray choices = doc.object()["choices"].toArray();
+                if (!choices.isEmpty()) {
+                    st->text = choices[0]
+                            .toObject()["message"]
+                            .toObject()["content"].toString();
+                }
+            }
+            if (!st->text.isEmpty()) {
+                st->firstTokenMs = st->timer.elapsed();
+                PerfStats::record("reply.firstToken", st->startNs, PerfStats::nowNs());
+                appendToHistory("AI", st->text);
+            }
         }
 
-        // Safety: keep last 20 messages to avoid token bloat
-        if (conversationHistory.size() > 20) {
-            conversationHistory.removeFirst();
+        const qint64 totalMs = st->timer.elapsed();
+        if (!st->text.isEmpty()) {
+            PerfStats::record("reply.total", st->startNs, PerfStats::nowNs());
+            QString timing = st->streaming
+                ? QString("Reply: first token %1 ms, complete %2 ms").arg(st->firstTokenMs).arg(totalMs)
+                : QString("Reply: complete %1 ms").arg(totalMs);
+            if (call->attempts() > 1)
+                timing += QString(" (%1 attempts)").arg(call->attempts());
+            statusBar()->showMessage(timing);
         }
-
-        // Re-enable UI
-        input->setEnabled(true);
-        sendBtn->setEnabled(true);
+        done(st->text);
     });
-
 }
 
-void ChatWindow::onApiReply(QNetworkReply *reply) {
-    QByteArray payload = reply->readAll();
+void ChatWindow::appendToEntry(qint64 entry, const QString &text) {
+    // an entry that scrolled out of the kept history just stops growing
+    const QTextBlock block = historyEntry(entry);
+    if (!block.isValid()) return;
 
-    if (reply->error() != QNetworkReply::NoError) {
-        appendToHistory("Error", reply->errorString());
-        reply->deleteLater();
-        input->setEnabled(true);
-        sendBtn->setEnabled(true);
-        return;
-    }
+    // keep following the conversation only if the user is at the bottom
+    QScrollBar *bar = history->verticalScrollBar();
+    const bool atBottom = bar->value() == bar->maximum();
 
-    QJsonDocument doc = QJsonDocument::fromJson(payload);
-    QString content;
-    if (doc.isObject()) {
-        auto root = doc.object();
-        auto choices = root["choices"].toArray();
-        if (!choices.isEmpty()) {
-            content = choices[0].toObject()
-            ["message"].toObject()
-                ["content"].toString();
-        }
-    }
-    if (content.isEmpty()) content = "(empty response)";
+    // a real newline would start a new block; stay inside this entry
+    QString t = text;
+    t.replace('\n', QChar::LineSeparator);
 
-    // show + add assistant turn to conversation
-    appendToHistory("AI", content);
-    messages.append(QJsonObject{{"role","assistant"},{"content",content}});
+    PerfScope scope("chat.appendToken");
+    QTextCursor cursor(block);
+    cursor.movePosition(QTextCursor::EndOfBlock);
+    cursor.insertText(t, QTextCharFormat());
 
-    reply->deleteLater();
-    input->setEnabled(true);
-    sendBtn->setEnabled(true);
+    if (atBottom) bar->setValue(bar->maximum());
 }
 
 void ChatWindow::sendImage(){
@@ -552,321 +722,150 @@ void ChatWindow::sendImage(){
         );
     if (path.isEmpty() || apiKey.isEmpty()) return;
 
-    //load + (optionally) downscale to keep payload small
-    QImage img(path);
-    if (img.isNull()){
-        appendToHistory("System", "Could not load image.");
-        return;
-    }
-
-    // Resize to max 1024px (keeps quality, reduces size)
-    QImage scaled = img.scaled(1024, 1024, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-
-    // Encode as JPEG base64 (smaller than PNG for photos)
-    QByteArray bytes;
-    QBuffer buf(&bytes);
-    buf.open(QIODevice::WriteOnly);
-    scaled.save(&buf, "JPEG", 85); // 85% quality
-    QByteArray b64 = bytes.toBase64();
-
-    // Build data URL
-    QString dataUrl = "data:image/jpeg;base64," + QString::fromLatin1(b64);
-
     //Optional: ask the model what to do
     QString prompt = "Describe this image in detail.";
 
-    // Show in history and send
+    // Show in history and send (loaded, downscaled and encoded off the GUI thread)
     appendToHistory("You", QString("[sent an image] %1").arg(prompt));
-    postImage(prompt, dataUrl);
+    encodeAndPost(encoder.encodeFile(path, ImageUse::Scene), prompt);
 
 }
 
-void ChatWindow::postImage(const QString &prompt, const QString &dataUrl){
-    input->setEnabled(false);
-    sendBtn->setEnabled(false);
-    sendImageBtn->setEnabled(false);
-
-    // Content parts for a single user message: text + image
-    QJsonArray content;
-    content.append(QJsonObject{{"type", "text"},{"text", prompt}});
-    content.append(QJsonObject{
-        {"type","image_url"},
-        {"image_url", QJsonObject{{"url", dataUrl}}}
-    });
+void ChatWindow::postImage(const QString &prompt, const QString &dataUrl,
+                           const std::function<void(const QString &)> &onReply){
+    // One conversation for text and images. The image is only uploaded
+    // with this request; afterwards memory keeps a hash reference.
+    const qint64 question = memory.ask(prompt, dataUrl);
 
-    //Keep full conversation constext
-    messages.append(QJsonObject{
-        {"role","user"},
-        {"content", content}
+    // the description only depends on the prompt and the image bytes
+    const QJsonArray msgs = memory.requestMessages(question);
+    requestCompletion(msgs, cacheContext(msgs), [this, question, onReply](const QString &replyText) {
+        if (replyText.isEmpty()) {
+            appendToHistory("AI", "(empty response)");
+            memory.forget(question);
+        } else {
+            // add assistant turn to conversation (drops the image data)
+            memory.answer(question, replyText);
+        }
+        if (onReply) onReply(replyText);
     });
-
-    // POST /v1/chat/completions
-    QNetworkRequest req(QUrl("https://api.openai.com/v1/chat/completions"));
-    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    req.setRawHeader("Authorization", QString("Bearer %1").arg(apiKey).toUtf8());
-
-    QJsonObject body;
-    body["model"] = "gpt-4o-mini";     // vision-capable
-    body["messages"] = messages;
-
-    QNetworkReply *reply = net->post(req, QJsonDocument(body).toJson());
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() { onApiReply(reply); });
 }
 
-static QString makeDataUrl(const QImage &img) {
-    QByteArray bytes; QBuffer buf(&bytes); buf.open(QIODevice::WriteOnly);
-    img.save(&buf, "JPEG", 90);
-    return "data:image/jpeg;base64," + QString::fromLatin1(bytes.toBase64());
-    // Optionally downscale to keep payload small
-    QImage scaled = img.scaled(1024,1024, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-}
-
-
 void ChatWindow::solveMazeFromFile() {
-    if (apiKey.isEmpty()) { appendToHistory("System","API key missing."); return; }
+    if (mazeWatcher.isRunning()) { appendToHistory("System","A maze is already being solved."); return; }
 
     const QString path = QFileDialog::getOpenFileName(this,"Pick maze image",{}, "Images (*.png *.jpg *.jpeg *.bmp *.webp)");
     if (path.isEmpty()) return;
 
-    QImage img(path);
-    if (img.isNull()) { appendToHistory("System","Could not load image."); return; }
-
-    // crop to the maze frame
-    QRect bbox = findMazeBBox(img);
-    QImage mazeOnly = img.copy(bbox);
-
-    // ---- build coarse grid and solve with BFS ----
-    QVector<QVector<bool>> grid;
-    int cellSize = 3; // 4px per cell; tweak as needed
-    buildGrid(mazeOnly, cellSize, grid);
+    // draw only at the size the preview shows; the full-size image is
+    // rendered and encoded afterwards, off the result path
+    MazeJobOptions opt = mazeOptionsFromUi();
+    opt.overlaySize = preview->size()*devicePixelRatioF();
+    opt.keepSource = !saveBox->currentData().toString().isEmpty();
+
+    // Load, crop, grid, solve and draw on the thread pool; the result
+    // comes back through mazeWatcher -> onMazeSolved on the GUI thread.
+    mazeWatcher.setFuture(QtConcurrent::run([path, opt](QPromise<MazeJobResult> &promise) {
+        promise.setProgressRange(0, 100);
+        const QImage img(path);
+        MazeJobResult r = runMazePipeline(img, opt, [&promise](int percent) {
+            promise.setProgressValue(percent);
+            return !promise.isCanceled();
+        });
+        if (!promise.isCanceled())
+            promise.addResult(r);
+    }));
 
-    QPoint start, goal;
-    if (!findOpenings(grid, start, goal)) {
-        appendToHistory("Error", "Could not find maze entrances.");
-        return;
-    }
+    appendToHistory("System", "Solving maze in the background...");
+    solveBtn->setEnabled(false);
+    cancelSolveBtn->setEnabled(true);
+}
 
-    // New: block all border cells except start & goal
-    const int gh = grid.size();
-    const int gw = grid[0].size();
+MazeJobOptions ChatWindow::mazeOptionsFromUi() const {
+    MazeJobOptions opt;
+    const int choice = solverBox->currentData().toInt();
+    opt.compareAll = choice < 0;
+    opt.solver = opt.compareAll ? MazeSolverKind::Bfs : MazeSolverKind(choice);
+    opt.smoothRoute = smoothBox->isChecked();
+    opt.distanceField = true;   // one extra BFS, then re-routing is free
+    return opt;
+}
 
-    auto same = [](const QPoint &a, const QPoint &b){
-        return a.x() == b.x() && a.y() == b.y();
-    };
+void ChatWindow::cancelMazeSolve() {
+    if (!mazeWatcher.isRunning()) return;
+    mazeWatcher.cancel();
+    cancelSolveBtn->setEnabled(false);
+}
 
-    // top & bottom rows
-    for (int x = 0; x < gw; ++x) {
-        QPoint top(x, 0);
-        QPoint bottom(x, gh - 1);
-        if (!same(top, start) && !same(top, goal))       grid[0][x] = false;
-        if (!same(bottom, start) && !same(bottom, goal)) grid[gh - 1][x] = false;
-    }
+void ChatWindow::onMazeSolved() {
+    solveBtn->setEnabled(true);
+    cancelSolveBtn->setEnabled(false);
+    cancelSolveBtn->setText("Cancel Solve");
 
-    // left & right columns
-    for (int y = 0; y < gh; ++y) {
-        QPoint left(0, y);
-        QPoint right(gw - 1, y);
-        if (!same(left, start) && !same(left, goal))     grid[y][0] = false;
-        if (!same(right, start) && !same(right, goal))   grid[y][gw - 1] = false;
+    if (mazeWatcher.isCanceled() || mazeWatcher.future().resultCount() == 0) {
+        appendToHistory("System", "Maze solve cancelled.");
+        return;
     }
 
-    QVector<QPoint> gridPath = bfsPath(grid, start, goal);
-    if (gridPath.isEmpty()) {
-        appendToHistory("Error", "No path found by BFS.");
+    const MazeJobResult r = mazeWatcher.result();
+    if (!r.ok) {
+        appendToHistory("Error", r.error);
         return;
     }
-    lastGridPath = gridPath;
-    QString movesJson = pathToMoves(gridPath);
-
-    // Convert grid cells -> normalized [0,1] coordinates inside mazeOnly
-    QVector<QPointF> points;
-    points.reserve(gridPath.size());
-    const double w = mazeOnly.width() - 1;
-    const double h = mazeOnly.height() - 1;
-    for (const QPoint &c : gridPath) {
-        double cx = (c.x() + 0.5) * cellSize;
-        double cy = (c.y() + 0.5) * cellSize;
-        // clamp inside image
-        cx = qBound(0.0, cx, w - 1.0);
-        cy = qBound(0.0, cy, h - 1.0);
-        double nx = cx / (w - 1.0);
-        double ny = cy / (h - 1.0);
-        points.append(QPointF(nx, ny));
-    }
-
-    // downscale this cropped maze for the API
-    QImage scaled = mazeOnly.scaled(1024, 1024, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-
-
-    const int W = scaled.width();
-    const int H = scaled.height();
-
-
-
-    // Build a strict vision message: ask ONLY JSON back
-    QJsonArray content;
-    content.append(QJsonObject{{"type","text"},{"text",
-    QString("You are a maze solver. White is free space. Black lines are walls.\n"
-            "Return ONLY JSON (no markdown, no prose), exactly:\n"
-            "Format: {\"path\":[[x0,y0],[x1,y1],...]}\n"
-            "Coordinates are floats in [0,1] with origin at TOP-LEFT (y increases downward).\n"
-            "Each step must move at most 0.02 in x or y (grid-like, no long jumps), "
-            "and all points must stay in white corridors (never cross a black wall).\n"
-            "Return between 120 and 200 points total."
-            "White inside the outer black frame is free space. "
-            "Black lines (including the outer rectangle) are walls. "
-            "You MUST stay inside the outer rectangle and never cross outside it.\n"
-            "Return ONLY JSON: {\"path\":[[x0,y0],[x1,y1],...]} ..."
-            )}});
-    content.append(QJsonObject{
-        {"type","image_url"},
-        {"image_url", QJsonObject{{"url", makeDataUrl(scaled)}}}
-    });
-
-    // We don’t mix this into the normal chat thread; send a one-off request
-    /*QNetworkRequest req(QUrl("https://api.openai.com/v1/chat/completions"));
-    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    req.setRawHeader("Authorization", QString("Bearer %1").arg(apiKey).toUtf8());
-
-    QJsonObject body;
-    body["model"] = "gpt-4o-mini";
-    body["messages"] = QJsonArray{
-        QJsonObject{{"role","user"},{"content",content}}
-    };
-
-    body["temperature"] = 0.0;                         // deterministic
-    body["max_tokens"] = 800;                          // enough for ~200 points
-    body["response_format"] = QJsonObject{{"type","json_object"}}; // JSON-only if supported
-
-    appendToHistory("You","[maze] Solve this maze and return JSON path.");
-
-    auto *reply = net->post(req, QJsonDocument(body).toJson());
-    connect(reply, &QNetworkReply::finished, this, [=]() {
-        QByteArray payload = reply->readAll();
-        reply->deleteLater();
 
-        QString text;
-        QJsonDocument doc = QJsonDocument::fromJson(payload);
-        if (doc.isObject()) {
-            QJsonArray choices = doc.object().value("choices").toArray();
-            if (!choices.isEmpty()) {
-                QJsonObject first   = choices.at(0).toObject();
-                QJsonObject message = first.value("message").toObject();
-                text = message.value("content").toString();
-            }
-        }
-
-        if (text.isEmpty()) {
-            appendToHistory("Error", "Empty response.");
-            return;
-        }
-
-        2) Try to parse as proper JSON: {"path":[[x,y],...]}
-        QString jsonText = extractJsonObject(text);   // if you already added this helper; if not, just use: jsonText = text;
-        QJsonParseError perr{};
-        QJsonDocument j = QJsonDocument::fromJson(jsonText.toUtf8(), &perr);
+    for (const QString &line : r.log)
+        appendToHistory("System", line);
 
-        QJsonArray pathArr;
-
-        if (perr.error == QJsonParseError::NoError && j.isObject()) {
-            pathArr = j.object().value("path").toArray();
-        }
-
-        // 3) If JSON failed OR pathArr empty, fall back to loose parser
-        QVector<QPointF> points;
-
-        if (!pathArr.isEmpty()) {
-            // convert QJsonArray → QVector<QPointF>
-            for (const QJsonValue &v : pathArr) {
-                const QJsonArray a = v.toArray();
-                if (a.size() != 2) continue;
-                double x = a.at(0).toDouble();
-                double y = a.at(1).toDouble();
-                if (x < 0.0) x = 0.0; if (x > 1.0) x = 1.0;
-                if (y < 0.0) y = 0.0; if (y > 1.0) y = 1.0;
-                points.append(QPointF(x, y));
-            }
-        } else {
-            appendToHistory("System", "JSON parse failed; using loose coordinate parser.");
-            points = parsePathFromLooseText(text);
-        }
-
-        if (points.size() < 2) {
-            appendToHistory("Error", "No usable path points found.");
-            appendToHistory("AI (raw)", text.left(1000));
-            return;
-        }
-        // ---- Add these helpers before drawing ----
-        auto clamp01 = [](double v){ return v < 0 ? 0 : (v > 1 ? 1 : v); };
-
-        auto countOutOfRange = [](const QJsonArray& path){
-            int bad = 0;
-            for (const QJsonValue &v : path) {
-                const auto a = v.toArray();
-                if (a.size()!=2) { ++bad; continue; }
-                double x=a[0].toDouble(), y=a[1].toDouble();
-                if (x<0 || x>1 || y<0 || y>1) ++bad;
-            }
-            return bad;
-        };
-
-        // Decide if we need to flip Y (origin mismatch)
-        int bad = 0;
-        for (const QPointF &p : points) {
-            if (p.x() < 0.0 || p.x() > 1.0 || p.y() < 0.0 || p.y() > 1.0) ++bad;
-        }
-        bool flipY = (bad > points.size() / 10);
-*/
-        // Draw overlay
-        QImage result = img.convertToFormat(QImage::Format_ARGB32);
-        QPainter p(&result);
-        QPen pen(Qt::red);
-        pen.setWidth(qMax(3, result.width()/200));
-        pen.setCapStyle(Qt::RoundCap);
-        pen.setJoinStyle(Qt::RoundJoin);
-        p.setRenderHint(QPainter::Antialiasing, true);
-        p.setPen(pen);
-
-        auto mapX = [&](double x){ return bbox.x() + qBound(0.0, x, 1.0) * w; };
-        auto mapY = [&](double y){ return bbox.y() + qBound(0.0, y, 1.0) * h; };
-
-        QPointF prev;
-        bool havePrev = false;
-        for (const QPointF &np : points) {
-            QPointF cur(mapX(np.x()), mapY(np.y()));
-            if (havePrev) p.drawLine(prev, cur);
-            prev = cur;
-            havePrev = true;
-        }
-        p.end();
-
-        // Save & preview
-        QString savePath = QDir::temp().filePath("maze_solved.png");
-        result.save(savePath, "PNG");
-        appendToHistory("System", "Maze solved locally (BFS). Saved to: " + savePath);
-        preview->setPixmap(QPixmap::fromImage(result).scaled(
-            preview->size()*devicePixelRatioF(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    setSolvedMaze(r);
+    appendToHistory("System", "Maze solved locally (" + r.solverName + ").");
+    showPreviewImage(r.overlay);
+    saveSolvedMaze(r);
+}
 
-    //});
+void ChatWindow::saveSolvedMaze(const MazeJobResult &r) {
+    const QStringList choice = saveBox->currentData().toString().split(':');
+    if (r.source.isNull() || choice.size() != 2) return;
+    if (saveWatcher.isRunning()) {
+        appendToHistory("System", "Still saving the previous maze, this one is not saved.");
+        return;
+    }
+    const QByteArray format = choice[0].toLatin1();
+    const int quality = choice[1].toInt();
+    const QString path = QDir::temp().filePath("maze_solved." + choice[0].toLower());
+    // r shares the source and grid data, nothing is copied here
+    saveWatcher.setFuture(QtConcurrent::run([r, path, format, quality] {
+        return saveOverlay(r.source, r, path, format.constData(), quality) ? path : QString();
+    }));
 }
+
 void ChatWindow::explainMazePath()
 {
-    if (lastGridPath.isEmpty()) {
+    if (lastRoute.isEmpty()) {
         appendToHistory("System",
                         "No maze path available yet. "
                         "Press 'Solve Maze' first.");
         return;
     }
 
-    QString movesJson = pathToMoves(lastGridPath);
+    // the commands themselves are computed here, instantly and always the same
+    char heading = 0;
+    const QVector<QPoint> route = carRoute(&heading);
+    const QVector<CarCommand> commands = movesToCommands(pathToMoveList(route), heading);
+    appendToHistory("System", "Route: " + commandsToText(commands, ", "));
+
+    QString movesJson = pathToMoves(route);
+    const QString from = heading == 0
+        ? QString("from the entrance")
+        : QString("from the car's current cell (%1,%2), facing %3,").arg(route.first().x()).arg(route.first().y())
+              .arg(QChar(heading));
 
     QString prompt =
         "You are a navigation assistant for a small robot car in a maze.\n"
-        "The maze has already been solved by a BFS algorithm on a grid.\n"
+        "The maze has already been solved by a shortest-path search on a grid.\n"
         "The path is given as a sequence of moves of the form "
         "{\"dir\":\"E\",\"steps\":5} where dir is one of N,E,S,W and "
         "steps is the number of grid cells.\n"
-        "Starting from the entrance and following the moves in order, "
+        "Starting " + from + " and following the moves in order, "
         "give clear step-by-step instructions using ONLY these commands:\n"
         "- FORWARD <cells>\n"
         "- TURN LEFT\n"
@@ -874,8 +873,211 @@ void ChatWindow::explainMazePath()
         "Be concise and numbered (Step 1, Step 2, ...).\n"
         "Here is the path:\n" + movesJson;
 
-    // Send this as a normal user message to the chat
-    postChat(prompt);
+    // Send this as a normal user message to the chat; the same path always
+    // gives the same prompt, so repeats come from the cache
+    postChat(prompt, true);
+}
+
+void ChatWindow::sendPathToCar()
+{
+    if (lastRoute.isEmpty()) {
+        appendToHistory("System",
+                        "No maze path available yet. "
+                        "Press 'Solve Maze' first.");
+        return;
+    }
+
+    if (!car.isOpen()) {
+        QString target = qEnvironmentVariable("SMARTSYSTEMS_CAR_LINK");
+        if (target.isEmpty())
+            target = "udp:raspberrypi.local:5006";
+        QString error;
+        if (!car.open(target, &error)) {
+            appendToHistory("Error", "Could not open car link " + target + ": " + error);
+            return;
+        }
+    }
+
+    char heading = 0;
+    const QVector<QPoint> route = carRoute(&heading);
+    if (route.isEmpty()) {
+        appendToHistory("Error", "The obstacles the car found leave no way to the goal.");
+        return;
+    }
+    sendCarPlan(route, heading, "Sending to the car on " + car.target() + ".");
+}
+
+void ChatWindow::sendCarPlan(const QVector<QPoint> &route, char heading, const QString &why)
+{
+    // a new plan replaces whatever the car has not driven yet
+    const QVector<MazeMove> moves = pathToMoveList(route);
+    planCommands = movesToCommands(moves, heading);
+    if (planCommands.isEmpty()) {
+        // already at the goal (or re-localized onto it): nothing to send
+        planRoute.clear();
+        appendToHistory("System", why + " The car is already at the goal.");
+        return;
+    }
+    planRoute = route;
+    planHeading = heading ? heading : (moves.isEmpty() ? 'N' : moves.first().dir);
+    planId = car.sendPlan(planCommands);
+    planDone = 0;
+    carStuck = false;
+    appendToHistory("System", why + QString(" Plan %1: %2").arg(planId).arg(commandsToText(planCommands, ", ")));
+}
+
+void ChatWindow::onCarProgress(quint8 id, int done, int total)
+{
+    statusBar()->showMessage(QString("Car: plan %1, %2/%3 commands done").arg(id).arg(done).arg(total));
+    if (id != planId || planRoute.isEmpty()) return;
+    planDone = done;
+    // dead reckoning along the plan until the car reports a corrected position
+    carHeading = planHeading;
+    carCell = applyCommands(planRoute.first(), carHeading, planCommands, done);
+}
+
+void ChatWindow::setSolvedMaze(const MazeJobResult &r)
+{
+    // a cell is cellSize pixels of the photo; the maze frame spans mazeWidthCm
+    cellCm = mazeWidthCm > 0 && r.bbox.width() > 0 ? mazeWidthCm * r.cellSize / r.bbox.width() : 0;
+    if (r.gridHash == lastGridHash && replanner.isValid())
+        return; // same maze: keep the car's position and the obstacles it found
+    lastGridHash = r.gridHash;
+    lastRoute = r.route;
+    lastDistances = r.distances;
+    carCell = QPoint(-1, -1);
+    sensorWalls.clear();
+    echoHits = 0;
+    carStuck = false;
+    replanner.reset(r.grid, r.start, r.goal);
+}
+
+QVector<QPoint> ChatWindow::carRoute(char *heading)
+{
+    *heading = 0;
+    if (carCell.x() < 0)
+        return lastRoute;
+    if (sensorWalls.isEmpty() && lastDistances.distance(carCell) >= 0) {
+        *heading = carHeading;
+        return routeCorners(lastDistances.pathFrom(carCell));
+    }
+    // the distance field does not know the obstacles: ask the replanner
+    replanner.moveStart(carCell);
+    if (!replanner.replan())
+        return {};
+    *heading = carHeading;
+    return routeCorners(replanner.path());
+}
+
+void ChatWindow::onCarPosition(const QPoint &cell, char heading)
+{
+    carCell = cell;
+    carHeading = heading;
+    if (!replanner.isValid()) return;
+
+    // re-route from where the car really is, without a new solve
+    char h = 0;
+    const QVector<QPoint> route = carRoute(&h);
+    if (route.isEmpty()) {
+        appendToHistory("Error", QString("Car reported cell (%1,%2), which has no way to the goal.")
+                                     .arg(cell.x()).arg(cell.y()));
+        return;
+    }
+    sendCarPlan(route, h, QString("Car re-localized at (%1,%2).").arg(cell.x()).arg(cell.y()));
+}
+
+// true if cell lies on one of the axis-aligned segments of route
+static bool routeContains(const QVector<QPoint> &route, const QPoint &cell)
+{
+    for (int i = 1; i < route.size(); ++i) {
+        const QPoint a = route[i - 1], b = route[i];
+        if (cell.x() >= qMin(a.x(), b.x()) && cell.x() <= qMax(a.x(), b.x())
+            && cell.y() >= qMin(a.y(), b.y()) && cell.y() <= qMax(a.y(), b.y()))
+            return true;
+    }
+    return route.size() == 1 && route.first() == cell;
 }
 
+void ChatWindow::onDistanceReading(int channel, int cm)
+{
+    static const int kFrontSensor = 1;      // sensor 1 looks ahead of the car
+    static const int kMaxRangeCm = 150;     // further echoes are too noisy to map
+    static const int kConfirmReadings = 3;  // echoes from one cell before it is blocked
+    if (channel != kFrontSensor || cm <= 0) return;
+    if (!replanner.isValid() || carCell.x() < 0 || cellCm <= 0) return;
+    // progress only comes per command, so during a FORWARD the car is
+    // somewhere past carCell: its readings can't be placed on the grid
+    if (planDone < planCommands.size() && planCommands[planDone].op == CarCommand::Forward) return;
+
+    static const QString dirs = "NESW";
+    static const QPoint steps[4] = {QPoint(0, -1), QPoint(1, 0), QPoint(0, 1), QPoint(-1, 0)};
+    const int h = dirs.indexOf(QChar(carHeading));
+    if (h < 0) return;
+
+    // the sensor saw through the cells before the echo (all of its range if
+    // there was none): obstacles it found there earlier are gone
+    const bool echo = cm <= kMaxRangeCm;
+    const int ahead = 1 + int(qMin(cm, kMaxRangeCm) / cellCm);
+    const MazeGrid &grid = replanner.grid();
+    QPoint cleared(-1, -1);
+    bool wall = false;                      // the echo is a wall of the photo
+    for (int i = 1; i <= ahead + 1; ++i) {
+        const QPoint c = carCell + steps[h] * i;
+        const bool sensorWall = sensorWalls.contains(c);
+        if (!grid.contains(c) || (!grid.isFree(c) && !sensorWall)) {
+            // an echo up to a cell short of a wall is taken to be that wall
+            wall = true;
+            break;
+        }
+        if (i >= ahead && echo) continue;   // the echo cell and the one behind it
+        if (i > ahead) break;
+        if (sensorWall && replanner.setFree(c)) {
+            sensorWalls.removeOne(c);
+            cleared = c;
+        }
+    }
+
+    const QPoint cell = carCell + steps[h] * ahead;
+    if (!echo || wall) {
+        echoHits = 0;
+    } else if (cell != echoCell) {
+        echoCell = cell;
+        echoHits = 1;
+    } else {
+        ++echoHits;
+    }
+
+    if (echoHits >= kConfirmReadings && replanner.setBlocked(cell)) {
+        sensorWalls.append(cell);
+        // only a blocked cell on the current plan needs a new one; the rest
+        // of the grid still gets the change for later searches
+        if (!routeContains(planRoute, cell)) {
+            statusBar()->showMessage(QString("Obstacle at (%1,%2), not on the route").arg(cell.x()).arg(cell.y()));
+            return;
+        }
+        replanner.moveStart(carCell);
+        MazeSolveStats stats;
+        if (!replanner.replan(&stats)) {
+            car.stop();
+            carStuck = true;
+            appendToHistory("Error", QString("Obstacle at (%1,%2) closed the last way to the goal. Car stopped.")
+                                         .arg(cell.x()).arg(cell.y()));
+            return;
+        }
+        sendCarPlan(routeCorners(replanner.path()), carHeading,
+                    QString("Obstacle at (%1,%2), re-planned in %3 us (%4 cells updated).")
+                        .arg(cell.x()).arg(cell.y()).arg(stats.elapsedNs / 1000).arg(stats.nodesExpanded));
+        return;
+    }
 
+    if (cleared.x() < 0) return;
+    statusBar()->showMessage(QString("Obstacle at (%1,%2) is gone").arg(cleared.x()).arg(cleared.y()));
+    // the car stopped for want of a way: try again with the cell open
+    if (!carStuck) return;
+    replanner.moveStart(carCell);
+    MazeSolveStats stats;
+    if (!replanner.replan(&stats)) return;
+    sendCarPlan(routeCorners(replanner.path()), carHeading,
+                QString("Obstacle at (%1,%2) is gone, re-planned in %3 us (%4 cells updated).")
+                    .arg(cleared.x()).arg(cleared.y()).arg(stats.elapsedNs / 1000).arg(stats.nodesExpanded));
+}
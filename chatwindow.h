@@ -1,35 +1,59 @@
 #pragma once
 #include <QMainWindow>
-#include <QTextEdit>
+#include <QPlainTextEdit>
 #include <QLineEdit>
 #include <QPushButton>
 #include <QLabel>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
+#include <QTextBlock>
+#include <QComboBox>
+#include <QCheckBox>
 #include <QJsonArray>
 #include <QFileDialog>
 #include <QBuffer>
 #include <QImage>
 #include <QVector>
 #include <QPoint>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <functional>
+
+#include "apiclient.h"
+#include "chatmemory.h"
+#include "imageencoder.h"
+#include "responsecache.h"
+#include "mazepipeline.h"
+#include "carlink.h"
+#include "mazereplanner.h"
+#include "scenegate.h"
 
 //Multimedia
 #include <QCamera>
 #include <QMediaCaptureSession>
 #include <QVideoSink>
 #include <QVideoFrame>
+#include <QGraphicsView>
+#include <QGraphicsScene>
+#include <QGraphicsPathItem>
+#include <QGraphicsVideoItem>
+#include <QStackedWidget>
 
 
 class ChatWindow : public QMainWindow {
     Q_OBJECT
 public:
     explicit ChatWindow(QWidget *parent = nullptr);
-    ~ChatWindow() = default;
+    ~ChatWindow();
+
+public slots:
+    void onDistanceReading(int channel, int cm); // from the dashboard: obstacles ahead
+
+protected:
+    void resizeEvent(QResizeEvent *event) override;
 
 private slots:
     void sendCurrentInput();
     void sendImage();       // Existing "send image from file"
-    void onApiReply(QNetworkReply *reply);
 
     void startCamera();
     void stopCamera();
@@ -37,37 +61,118 @@ private slots:
     void captureAndSend();  // Capture current frame and send to AI
 
     void solveMazeFromFile(); // Solving mazes (drawn/pictures)
+    void cancelMazeSolve();
+    void onMazeSolved();
     void explainMazePath();
+    void sendPathToCar();
+    void onCarPosition(const QPoint &cell, char heading);
+    void onCarProgress(quint8 id, int done, int total);
+
+    void toggleLiveSolve(bool on); // solve the maze in front of the camera
+    void onLiveSolved();
+    void toggleAutoDescribe(bool on); // describe the scene when it changes
+    void autoDescribeTick();
 private:
 
-    void postChat(const QString &userText);
-    void postImage(const QString &prompt, const QString &dataUrl);
-    void appendToHistory(const QString &speaker, const QString &text);
+    void postChat(const QString &userText, bool selfContained = false);
+    // onReply gets the answer, empty on any error (encoding included)
+    void postImage(const QString &prompt, const QString &dataUrl,
+                   const std::function<void(const QString &)> &onReply = {});
+    void encodeAndPost(const QFuture<EncodedImage> &job, const QString &prompt,
+                       const std::function<void(const QString &)> &onReply = {});
+    void requestCompletion(const QJsonArray &messages, const QJsonArray &keyMessages,
+                           const std::function<void(const QString &)> &done);
+    static QJsonArray cacheContext(const QJsonArray &messages);
+    void readCompletion(ApiCall *call, const std::function<void(const QString &)> &done);
+    qint64 appendToHistory(const QString &speaker, const QString &text); // returns the entry
+    void appendToEntry(qint64 entry, const QString &text); // streamed tokens
+    QTextBlock historyEntry(qint64 entry) const;           // invalid once trimmed
+    void maybeStartLiveSolve();
+    void updateLiveRoute();
+    QImage currentFrame() const;      // latest camera frame, converted on demand
+    void showPreviewImage(const QImage &img);
+    void fitPreview();
+    MazeJobOptions mazeOptionsFromUi() const;
+    QVector<QPoint> carRoute(char *heading);  // from the car's cell if known
+    void sendCarPlan(const QVector<QPoint> &route, char heading, const QString &message);
+    void setSolvedMaze(const MazeJobResult &r);
+    void saveSolvedMaze(const MazeJobResult &r);
 
     // UI
-    QTextEdit *history;
+    QPlainTextEdit *history;      // one block per entry, oldest dropped past the limit
+    qint64 historyEntries = 0;    // entries appended so far
     QLineEdit *input;
     QPushButton *sendBtn;
     QPushButton *sendImageBtn;
+    QCheckBox *streamBox;         // request SSE streaming replies
     QPushButton *guideBtn;
-    QVector<QPoint> lastGridPath; // <-- store BFS result here
+    QPushButton *carBtn;          // stream the solved route to the car
+    QComboBox *solverBox;         // BFS / bidirectional BFS / A* / compare all
+    QCheckBox *smoothBox;         // draw the any-angle route
+    QComboBox *saveBox;           // save the full-size solved image, and how
+    QPushButton *solveBtn;
+    QPushButton *cancelSolveBtn;
+    QFutureWatcher<MazeJobResult> mazeWatcher; // background maze job
+    QFutureWatcher<QString> saveWatcher;       // background overlay save, empty: failed
+    QVector<QPoint> lastRoute;    // corners of the last solved path
+    DistanceField lastDistances;  // to the goal of the last solved maze
+    size_t lastGridHash = 0;
 
     // Camera UI
-    QLabel *preview;            // live preview
+    QLabel *preview;            // still images (solved maze, messages)
     QPushButton *startCamBtn;
     QPushButton *captureBtn;
     QPushButton *stopCamBtn;
+    QPushButton *liveSolveBtn;
+    QPushButton *autoDescribeBtn;
+    QStackedWidget *previewStack;   // preview label or live video
+    QGraphicsView *videoView;
+    QGraphicsScene *videoScene;
+    QGraphicsVideoItem *videoItem;  // owned by videoScene
+    QGraphicsPathItem *routeItem;   // live route, child of videoItem
+
+    // Live solve: at most one job in flight, newer frames are dropped
+    QFutureWatcher<MazeJobResult> liveWatcher;
+    QElapsedTimer liveThrottle;
+    int liveIntervalMs = 250;       // max ~4 solves per second
+    size_t liveGridHash = 0;        // grid of the last frame that was solved
+    int liveCellSize = 0;
+    QRect liveBBox;
+    QVector<QPoint> livePath;       // route drawn on the video; empty: none
 
+    // Auto describe: a frame is only uploaded when it differs from the last
+    // one described (or that is too old); otherwise the last answer stands
+    QTimer autoTimer;
+    QElapsedTimer autoClock;
+    SceneGate sceneGate;
+    bool autoBusy = false;          // a description is on its way
 
     // Networking / chat
-    QNetworkAccessManager *net;
-    QJsonArray messages;        // running conversation
+    ApiClient *api;             // queue, retries, pre-warmed connection
     QString apiKey;             // from env var
-    QJsonArray conversationHistory; // memory AI chat
+    ChatMemory memory;          // the conversation (text and image turns)
+    ImageEncoder encoder;       // scale + JPEG + base64 on a worker thread
+    ResponseCache cache;        // replies by request hash (disk: $SMARTSYSTEMS_CACHE_DIR)
+
+    // Car
+    CarLink car;                // opened on first use ($SMARTSYSTEMS_CAR_LINK)
+    QPoint carCell {-1, -1};    // reported or dead-reckoned position, if any
+    char carHeading = 0;
+    MazeReplanner replanner;    // grid + obstacles seen by the car
+    QVector<QPoint> sensorWalls; // cells the distance sensor blocked
+    QPoint echoCell {-1, -1};   // where the last front readings ended
+    int echoHits = 0;           // consecutive readings that ended there
+    bool carStuck = false;      // stopped because obstacles closed every way
+    double mazeWidthCm = 0;     // real width of the maze ($SMARTSYSTEMS_MAZE_WIDTH_CM)
+    double cellCm = 0;          // grid cell of the solved maze in cm, 0: unknown
+    QVector<QPoint> planRoute;  // route of the plan on the car
+    QVector<CarCommand> planCommands;
+    char planHeading = 0;
+    quint8 planId = 0;
+    int planDone = 0;           // commands of the plan the car has finished
 
     // Multimedia
     QCamera *camera = nullptr;
     QMediaCaptureSession captureSession;
-    QVideoSink *videoSink = nullptr;
-    QImage lastFrame;           // Latest frame as QImage
+    QVideoFrame lastVideoFrame;  // latest frame, shared with the video item
 };
@@ -1,46 +1,186 @@
 #include "dashboard.h"
+#include "perfstats.h"
+#include "sensorplot.h"
+#include "sensorreader.h"
 #include "ui_dashboard.h"
+#include <QDateTime>
+#include <QFileDialog>
 #include <QtDebug>
+#include <QtSerialPort/QSerialPortInfo>
 
 Dashboard::Dashboard(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::Dashboard)
-    , serial(new QSerialPort(this))
+    , reader(new SensorReader)
 {
     ui->setupUi(this);
     setWindowTitle("Sensor Dashboard");
 
-    // Configure serial port
-    serial->setPortName("COM3");   // <-- change this to your serial port
-    serial->setBaudRate(QSerialPort::Baud9600);
-    serial->setDataBits(QSerialPort::Data8);
-    serial->setParity(QSerialPort::NoParity);
-    serial->setStopBits(QSerialPort::OneStop);
-    serial->setFlowControl(QSerialPort::NoFlowControl);
-
-    if (serial->open(QIODevice::ReadOnly)) {
-        qDebug() << "Serial port opened.";
-        connect(serial, &QSerialPort::readyRead, this, &Dashboard::readSensorData);
-    } else {
-        qDebug() << "Failed to open serial port:" << serial->errorString();
-    }
+    // History plot of both sensors (~8 minutes at 1 kHz each)
+    history[1] = std::make_unique<TimeSeries>();
+    history[2] = std::make_unique<TimeSeries>();
+    plot = new SensorPlot(ui->centralwidget);
+    plot->setGeometry(20, 150, 761, 361);
+    plot->addSeries(history[1].get(), QColor(80, 200, 255), "Sensor 1");
+    plot->addSeries(history[2].get(), QColor(255, 170, 60), "Sensor 2");
+    for (int seconds : {10, 60, 300})
+        ui->windowBox->addItem(seconds < 60 ? QString("%1 s").arg(seconds) : QString("%1 min").arg(seconds / 60), seconds);
+    connect(ui->windowBox, &QComboBox::currentIndexChanged, this, [this] {
+        plot->setWindowSeconds(ui->windowBox->currentData().toInt());
+    });
+
+    // Port list; SMARTSYSTEMS_SERIAL_PORT picks the default (COM3 if nothing is found).
+    // "udp:<port>" listens for SensorPacket batches from the Raspberry Pi instead.
+    for (const QSerialPortInfo &info : QSerialPortInfo::availablePorts())
+        ui->portBox->addItem(info.portName());
+    ui->portBox->addItem("udp:5005");
+    const QString wanted = qEnvironmentVariable("SMARTSYSTEMS_SERIAL_PORT");
+    if (!wanted.isEmpty()) ui->portBox->setCurrentText(wanted);
+    else if (ui->portBox->count() == 1) ui->portBox->setCurrentText("COM3");
+
+    // The Arduino sketch must use the same rate; 115200 is the default now
+    for (int baud : {9600, 57600, 115200, 230400, 460800, 921600, 1000000, 2000000})
+        ui->baudBox->addItem(QString::number(baud));
+    ui->baudBox->setCurrentText("115200");
+
+    // Serial I/O on its own thread; readings come back through a lock-free queue
+    reader->moveToThread(&ioThread);
+    connect(&ioThread, &QThread::finished, reader, &QObject::deleteLater);
+    connect(reader, &SensorReader::opened, this, [this](bool ok, const QString &message) {
+        qDebug() << "Sensors:" << message;
+        if (ok) clearHistory(); // new source, new time base
+        connected = ok;
+        linkName = message;
+        ui->connectButton->setText(ok ? "Disconnect" : "Connect");
+        ui->labelStats->setText(message);
+    });
+    connect(reader, &SensorReader::closed, this, [this] {
+        connected = false;
+        ui->connectButton->setText("Connect");
+        ui->labelStats->setText("Not connected");
+    });
+    connect(reader, &SensorReader::recording, this, [this](bool on, const QString &message) {
+        QSignalBlocker block(ui->recordButton);
+        ui->recordButton->setChecked(on);
+        ui->labelStats->setText(message);
+    });
+    connect(reader, &SensorReader::replayFinished, this, [this](const QString &summary) {
+        refresh();
+        ui->labelStats->setText(summary);
+    });
+    ioThread.setObjectName("sensor-io");
+    ioThread.start();
+
+    connect(ui->connectButton, &QPushButton::clicked, this, &Dashboard::toggleConnection);
+
+    // Record the raw link / replay a recording through the same parser
+    ui->speedBox->addItem("1x", true);
+    ui->speedBox->addItem("Max speed", false);
+    connect(ui->recordButton, &QPushButton::toggled, this, &Dashboard::toggleRecording);
+    connect(ui->replayButton, &QPushButton::clicked, this, &Dashboard::startReplay);
+    connect(&refreshTimer, &QTimer::timeout, this, &Dashboard::refresh);
+    refreshTimer.start(1000 / refreshHz);
+
+    toggleConnection();
 }
 
 
 Dashboard::~Dashboard() {
+    refreshTimer.stop();
+    QMetaObject::invokeMethod(reader, &SensorReader::close, Qt::BlockingQueuedConnection);
+    ioThread.quit();
+    ioThread.wait();
     delete ui;
 }
 
-void Dashboard::readSensorData() {
-    QByteArray data = serial->readAll();
-    QString text = QString::fromUtf8(data).trimmed();
+void Dashboard::toggleConnection() {
+    if (connected) {
+        QMetaObject::invokeMethod(reader, &SensorReader::close);
+        return;
+    }
+    const QString port = ui->portBox->currentText().trimmed();
+    if (port.startsWith("udp:", Qt::CaseInsensitive)) {
+        const quint16 udpPort = quint16(port.mid(4).toUInt());
+        QMetaObject::invokeMethod(reader, [this, udpPort] { reader->openUdp(udpPort); });
+        return;
+    }
+    const int baud = ui->baudBox->currentText().toInt();
+    QMetaObject::invokeMethod(reader, [this, port, baud] { reader->openSerial(port, baud); });
+}
 
-    // Example: Arduino sends "123" (distance in cm)
-    bool ok;
-    int distance = text.toInt(&ok);
-    if (ok) {
-        qDebug() << "Distance:" << distance << "cm";
-        ui->labelSensor1->setText(QString("Distance: %1 cm").arg(distance));
-        // assuming you added a QLabel called "label" in dashboard.ui
+void Dashboard::toggleRecording(bool on) {
+    if (!on) {
+        QMetaObject::invokeMethod(reader, &SensorReader::stopRecording);
+        return;
+    }
+    const QString suggested = QString("sensors_%1.sslog").arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
+    const QString path = QFileDialog::getSaveFileName(this, "Record sensor session", suggested, "Sensor logs (*.sslog)");
+    if (path.isEmpty()) {
+        QSignalBlocker block(ui->recordButton);
+        ui->recordButton->setChecked(false);
+        return;
     }
+    QMetaObject::invokeMethod(reader, [this, path] { reader->startRecording(path); });
+}
+
+void Dashboard::startReplay() {
+    const QString path = QFileDialog::getOpenFileName(this, "Replay sensor session", {}, "Sensor logs (*.sslog)");
+    if (path.isEmpty()) return;
+    const bool realTime = ui->speedBox->currentData().toBool();
+    QMetaObject::invokeMethod(reader, [this, path, realTime] { reader->openReplay(path, realTime); });
+}
+
+void Dashboard::clearHistory() {
+    for (auto &h : history)
+        if (h) h->clear();
+    for (ChannelWindow &w : channels) w.count = 0;
+    plot->update();
+}
+
+void Dashboard::refresh() {
+    // drain everything that arrived since the last frame
+    PerfScope scope("dashboard.refresh");
+    SensorSample s;
+    int drained = 0;
+    while (reader->queue().tryPop(s)) {
+        ++drained;
+        if (s.channel > SensorParser::kMaxChannel) continue;
+        channels[s.channel].add(s.value);
+        if (!history[s.channel])
+            history[s.channel] = std::make_unique<TimeSeries>();
+        TimeSeries &h = *history[s.channel];
+        // history is time ordered; a reordered UDP packet only misses the plot
+        // (a new source or replay clears it when it opens)
+        if (!h.isEmpty() && s.timeUs < h.lastTime())
+            continue;
+        h.append(s.timeUs, s.value);
+    }
+    PerfStats::count("sensor.samples", drained);
+    if (drained) plot->update();
+
+    // Arduino sends "123" (distance in cm, sensor 1), "2:45" or binary frames
+    QLabel *labels[] = {nullptr, ui->labelSensor1, ui->labelSensor2};
+    for (int ch = 1; ch <= 2; ++ch) {
+        ChannelWindow &w = channels[ch];
+        if (w.count == 0) continue; // keep the last text
+        emit distanceReading(ch, w.min);
+        labels[ch]->setText(w.count == 1
+            ? QString("Distance: %1 cm").arg(w.latest)
+            : QString("Distance: %1 cm\n(min %2, max %3, avg %4, %5 readings)")
+                  .arg(w.latest).arg(w.min).arg(w.max)
+                  .arg(double(w.sum) / w.count, 0, 'f', 1).arg(w.count));
+    }
+    for (ChannelWindow &w : channels) w.count = 0;
+
+    if (connected) updateStats();
+}
+
+void Dashboard::updateStats() {
+    QString text = QString("%1: %2 readings, %3 malformed, %4 bytes dropped")
+                       .arg(linkName).arg(reader->frames()).arg(reader->malformed()).arg(reader->droppedBytes());
+    if (reader->lostPackets())
+        text += QString(", %1 packets lost").arg(reader->lostPackets());
+    if (reader->queueOverflows())
+        text += QString(", %1 lost (queue full)").arg(reader->queueOverflows());
+    ui->labelStats->setText(text);
 }
@@ -1,6 +1,15 @@
 #pragma once
 #include <QMainWindow>
-#include <QtSerialPort/QSerialPort>
+#include <QThread>
+#include <QTimer>
+
+#include "sensorparser.h"
+#include "timeseries.h"
+
+#include <memory>
+
+class SensorReader;
+class SensorPlot;
 
 namespace Ui {
 class Dashboard;
@@ -13,10 +22,45 @@ public:
     explicit Dashboard(QWidget *parent = nullptr);
     ~Dashboard();
 
+signals:
+    // nearest distance a sensor saw during the last redraw interval
+    void distanceReading(int channel, int cm);
+
 private:
-    void readSensorData();
+    void toggleConnection();
+    void toggleRecording(bool on);
+    void startReplay();
+    void clearHistory();
+    void refresh();
+    void updateStats();
+
+    // what one channel did since the last redraw
+    struct ChannelWindow {
+        qint32 latest = 0, min = 0, max = 0;
+        qint64 sum = 0;
+        int count = 0;
+        void add(qint32 v) {
+            if (count == 0) { min = max = v; sum = 0; }
+            latest = v;
+            min = qMin(min, v);
+            max = qMax(max, v);
+            sum += v;
+            ++count;
+        }
+    };
 
 private:
     Ui::Dashboard *ui;
-    QSerialPort *serial;
+    QThread ioThread;               // serial port + parser run here
+    SensorReader *reader;           // owned by ioThread
+    bool connected = false;
+    QString linkName;
+
+    QTimer refreshTimer;            // redraws at a fixed rate, whatever the sensor rate
+    int refreshHz = 30;
+    ChannelWindow channels[SensorParser::kMaxChannel + 1];
+
+    // full history per channel (created when a channel first shows up)
+    std::unique_ptr<TimeSeries> history[SensorParser::kMaxChannel + 1];
+    SensorPlot *plot;
 };
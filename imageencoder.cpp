@@ -0,0 +1,75 @@
+#include "imageencoder.h"
+#include "perfstats.h"
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrent>
+
+ImageEncodeTarget imageEncodeTarget(ImageUse use)
+{
+    switch (use) {
+    case ImageUse::Scene: return {1024, 80};
+    }
+    return {1024, 80};
+}
+
+ImageEncoder::ImageEncoder()
+{
+    pool.setMaxThreadCount(1);
+    pool.setObjectName("image-encoder"); // thread name in the trace
+}
+
+ImageEncoder::~ImageEncoder()
+{
+    pool.waitForDone();
+}
+
+QFuture<EncodedImage> ImageEncoder::encode(const QImage &img, ImageUse use)
+{
+    return QtConcurrent::run(&pool, [this, img, use] { return run(img, use); });
+}
+
+QFuture<EncodedImage> ImageEncoder::encodeFile(const QString &path, ImageUse use)
+{
+    // decoding the file is part of the work, keep it off the GUI thread too
+    return QtConcurrent::run(&pool, [this, path, use] {
+        PerfScope decode("image.decode");
+        const QImage img(path);
+        decode.stop();
+        return run(img, use);
+    });
+}
+
+EncodedImage ImageEncoder::run(const QImage &img, ImageUse use)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    EncodedImage out;
+    if (img.isNull()) { out.error = "Could not load image."; return out; }
+
+    PerfScope stage("image.scale");
+    const ImageEncodeTarget t = imageEncodeTarget(use);
+    QImage scaled = img;
+    if (img.width() > t.maxSide || img.height() > t.maxSide) {
+        // big camera frames: cheap halving first, smooth filter for the last step
+        const QSize target = img.size().scaled(t.maxSide, t.maxSide, Qt::KeepAspectRatio);
+        if (img.width() > 2 * target.width())
+            scaled = img.scaled(target * 2, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+        scaled = scaled.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    stage.next("image.jpeg");
+    jpeg.resize(0); // keeps the capacity from the last image
+    QBuffer buf(&jpeg);
+    buf.open(QIODevice::WriteOnly);
+    if (!scaled.save(&buf, "JPEG", t.quality)) { out.error = "JPEG encoding failed."; return out; }
+    buf.close();
+
+    stage.next("image.base64");
+    out.dataUrl = "data:image/jpeg;base64," + QString::fromLatin1(jpeg.toBase64());
+    out.size = scaled.size();
+    out.bytes = jpeg.size();
+    out.encodeUs = timer.nsecsElapsed() / 1000;
+    return out;
+}
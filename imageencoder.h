@@ -0,0 +1,44 @@
+#pragma once
+#include <QByteArray>
+#include <QFuture>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+
+// What the image is for; picks resolution and quality.
+enum class ImageUse {
+    Scene   // camera / photo description: 1024px, JPEG 80
+};
+
+struct ImageEncodeTarget {
+    int maxSide;
+    int quality;
+};
+
+ImageEncodeTarget imageEncodeTarget(ImageUse use);
+
+struct EncodedImage {
+    QString dataUrl;            // data:image/jpeg;base64,... (empty on failure)
+    QString error;
+    QSize size;                 // encoded resolution
+    qint64 bytes = 0;           // JPEG size before base64
+    qint64 encodeUs = 0;        // load + scale + encode + base64
+};
+
+// Scale -> JPEG -> base64 data URL on its own worker thread, so the GUI
+// never waits for it. The JPEG buffer is kept between calls.
+class ImageEncoder {
+public:
+    ImageEncoder();
+    ~ImageEncoder();
+
+    QFuture<EncodedImage> encode(const QImage &img, ImageUse use);
+    QFuture<EncodedImage> encodeFile(const QString &path, ImageUse use);
+
+private:
+    EncodedImage run(const QImage &img, ImageUse use);
+
+    QThreadPool pool;           // one thread: buffer below is never shared
+    QByteArray jpeg;
+};
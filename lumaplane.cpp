@@ -0,0 +1,134 @@
+#include "lumaplane.h"
+#include "rowbands.h"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LUMA_SSE2 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LUMA_NEON 1
+#endif
+
+// Rec.709 weights in 8.8 fixed point (sum is 256, so white stays 255)
+enum { kWR = 54, kWG = 183, kWB = 19 };
+
+static inline uchar lumaOf(QRgb c)
+{
+    return uchar((kWR*qRed(c) + kWG*qGreen(c) + kWB*qBlue(c)) >> 8);
+}
+
+#if defined(__AVX2__)
+// 8 pixels -> 8 x 32-bit luma values
+static inline __m256i luma8(__m256i p)
+{
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m256i b = _mm256_and_si256(p, mask);
+    const __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 8), mask);
+    const __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 16), mask);
+    // every product fits in 16 bits, so a 16-bit multiply is exact here
+    __m256i s = _mm256_mullo_epi16(r, _mm256_set1_epi32(kWR));
+    s = _mm256_add_epi32(s, _mm256_mullo_epi16(g, _mm256_set1_epi32(kWG)));
+    s = _mm256_add_epi32(s, _mm256_mullo_epi16(b, _mm256_set1_epi32(kWB)));
+    return _mm256_srli_epi32(s, 8);
+}
+#elif defined(LUMA_SSE2)
+// 4 pixels -> 4 x 32-bit luma values
+static inline __m128i luma4(__m128i p)
+{
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i b = _mm_and_si128(p, mask);
+    const __m128i g = _mm_and_si128(_mm_srli_epi32(p, 8), mask);
+    const __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), mask);
+    // every product fits in 16 bits, so a 16-bit multiply is exact here
+    __m128i s = _mm_mullo_epi16(r, _mm_set1_epi32(kWR));
+    s = _mm_add_epi32(s, _mm_mullo_epi16(g, _mm_set1_epi32(kWG)));
+    s = _mm_add_epi32(s, _mm_mullo_epi16(b, _mm_set1_epi32(kWB)));
+    return _mm_srli_epi32(s, 8);
+}
+#endif
+
+void lumaRow(const QRgb *src, uchar *dst, int n)
+{
+    int x = 0;
+#if defined(__AVX2__)
+    for (; x + 32 <= n; x += 32) {
+        const __m256i *s = reinterpret_cast<const __m256i*>(src + x);
+        const __m256i a = luma8(_mm256_loadu_si256(s));
+        const __m256i b = luma8(_mm256_loadu_si256(s + 1));
+        const __m256i c = luma8(_mm256_loadu_si256(s + 2));
+        const __m256i d = luma8(_mm256_loadu_si256(s + 3));
+        // packs work per 128-bit lane; the permute restores pixel order
+        __m256i v = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), v);
+    }
+#elif defined(LUMA_SSE2)
+    for (; x + 16 <= n; x += 16) {
+        const __m128i *s = reinterpret_cast<const __m128i*>(src + x);
+        const __m128i a = luma4(_mm_loadu_si128(s));
+        const __m128i b = luma4(_mm_loadu_si128(s + 1));
+        const __m128i c = luma4(_mm_loadu_si128(s + 2));
+        const __m128i d = luma4(_mm_loadu_si128(s + 3));
+        const __m128i v = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), v);
+    }
+#elif defined(LUMA_NEON)
+    // QRgb is stored B,G,R,A in memory on little-endian ARM
+    const uint8x8_t wr = vdup_n_u8(kWR), wg = vdup_n_u8(kWG), wb = vdup_n_u8(kWB);
+    for (; x + 16 <= n; x += 16) {
+        const uint8x16x4_t px = vld4q_u8(reinterpret_cast<const uint8_t*>(src + x));
+        uint16x8_t lo = vmull_u8(vget_low_u8(px.val[2]), wr);
+        lo = vmlal_u8(lo, vget_low_u8(px.val[1]), wg);
+        lo = vmlal_u8(lo, vget_low_u8(px.val[0]), wb);
+        uint16x8_t hi = vmull_u8(vget_high_u8(px.val[2]), wr);
+        hi = vmlal_u8(hi, vget_high_u8(px.val[1]), wg);
+        hi = vmlal_u8(hi, vget_high_u8(px.val[0]), wb);
+        vst1q_u8(dst + x, vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)));
+    }
+#endif
+    for (; x < n; ++x)
+        dst[x] = lumaOf(src[x]);
+}
+
+LumaPlane::LumaPlane(const QImage &img)
+{
+    if (img.isNull()) return;
+
+    w = img.width();
+    h = img.height();
+    lineStride = w;
+    buf.resize(qsizetype(w) * h);
+    uchar *out = buf.data();
+
+    if (img.format() == QImage::Format_Grayscale8) {
+        for (int y = 0; y < h; ++y)
+            memcpy(out + qsizetype(y) * w, img.constScanLine(y), w);
+        return;
+    }
+
+    // the SIMD kernels read plain 32-bit pixels
+    const QImage src = (img.format() == QImage::Format_RGB32 || img.format() == QImage::Format_ARGB32)
+                           ? img : img.convertToFormat(QImage::Format_ARGB32);
+    forEachRowBand(rowBandCount(h, w), h, [&](int, int yBegin, int yEnd) {
+        for (int y = yBegin; y < yEnd; ++y)
+            lumaRow(reinterpret_cast<const QRgb*>(src.constScanLine(y)), out + qsizetype(y) * w, w);
+    });
+}
+
+LumaPlane LumaPlane::cropped(const QRect &r) const
+{
+    const QRect c = r.intersected(QRect(0, 0, w, h));
+    LumaPlane v;
+    if (c.isEmpty()) return v;
+    v.w = c.width();
+    v.h = c.height();
+    v.lineStride = lineStride;
+    v.origin = origin + c.y() * lineStride + c.x();
+    v.buf = buf;
+    return v;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+// 8-bit luminance plane of an image, computed once per maze so that every
+// stage (bounding box, grid building) reads bytes instead of decoding QRgb.
+// Weights are the Rec.709 ones in 8.8 fixed point: (54 R + 183 G + 19 B) >> 8.
+class LumaPlane {
+public:
+    LumaPlane() = default;
+    explicit LumaPlane(const QImage &img);
+
+    int width() const  { return w; }
+    int height() const { return h; }
+    bool isNull() const { return w <= 0 || h <= 0; }
+
+    const uchar *row(int y) const { return buf.constData() + origin + y * lineStride; }
+    uchar at(int x, int y) const  { return row(y)[x]; }
+
+    // Sub-rectangle view sharing the same buffer (no copy)
+    LumaPlane cropped(const QRect &r) const;
+
+private:
+    int w = 0;
+    int h = 0;
+    int lineStride = 0;
+    int origin = 0;
+    QVector<uchar> buf;
+};
+
+// Convert n 32-bit pixels to 8-bit luminance (SSE2/AVX2/NEON where available)
+void lumaRow(const QRgb *src, uchar *dst, int n);
@@ -28,6 +28,7 @@ MainWindow::~MainWindow() {
 void MainWindow::on_button1_clicked() {
 
     if (!chatWindow) chatWindow = new ChatWindow(this);  // create once
+    linkWindows();
     chatWindow->show();
     chatWindow->raise();
     chatWindow->activateWindow();
@@ -66,7 +67,22 @@ void MainWindow::on_button2_clicked() {
     if (!dashboard) {
         dashboard = new Dashboard(this);  // create once
     }
+    linkWindows();
     dashboard->show();  // open the dashboard window
     dashboard->raise();
     dashboard->activateWindow();
 }
+
+void MainWindow::on_button3_clicked() {
+    if (!perfPanel) perfPanel = new PerfPanel(this);  // create once
+    perfPanel->show();
+    perfPanel->raise();
+    perfPanel->activateWindow();
+}
+
+void MainWindow::linkWindows() {
+    // obstacles the car's distance sensors see go into the maze replanner
+    if (chatWindow && dashboard)
+        connect(dashboard, &Dashboard::distanceReading, chatWindow, &ChatWindow::onDistanceReading,
+                Qt::UniqueConnection);
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "chatwindow.h"
 #include "dashboard.h"   // include the new widget
+#include "perfpanel.h"
 #include <QMainWindow>
 #include <QtNetwork/QNetworkAccessManager>
 #include <QtNetwork/QNetworkReply>
@@ -20,13 +21,17 @@ private slots:
     void on_button1_clicked();
     void onApiReply(QNetworkReply *reply);
     void on_button2_clicked();
+    void on_button3_clicked();   // performance panel
 
 private:
+    void linkWindows();     // sensor readings -> chat window replanner
+
     Ui::MainWindow *ui;
     Dashboard *dashboard;   // pointer to the dashboard
 
     QNetworkAccessManager *networkManager;
     ChatWindow *chatWindow = nullptr;
+    PerfPanel *perfPanel = nullptr;
 };
 
 
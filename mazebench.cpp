@@ -0,0 +1,420 @@
+// Maze pipeline benchmark.
+// Times every stage of the pipeline (luminance, crop, integral image, grid,
+// openings, solve, route, whole job) over a corpus of maze images at several
+// resolutions and cell sizes, with the heap allocations of each stage.
+//
+//   mazebench                          1080p, 4K and 8K synthetic mazes
+//   mazebench mazes/ a.png             every image in mazes/, plus a.png
+//     --runs N                         repetitions per stage (default 5)
+//     --cells 2,3,4                    cell sizes (default 2,3,4,6)
+//     --scales 100,50                  image scales in percent (default 100,50,25)
+//     --legacy                         also compare with the old
+//                                      QVector<QVector<bool>> grid and BFS
+
+#include "mazegrid.h"
+#include "mazepipeline.h"
+#include "mazereplanner.h"
+#include "perfstats.h"
+#include "mazesolver.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QTextStream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <queue>
+#include <random>
+#include <algorithm>
+
+/* ======== Allocation counting ======== */
+
+// Every heap allocation of the process is counted. With glibc malloc itself
+// is wrapped, which also catches Qt containers and QImage; elsewhere only
+// operator new is seen.
+static std::atomic<qint64> allocCount{0};
+static std::atomic<qint64> allocBytes{0};
+
+static inline void countAlloc(size_t n)
+{
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(qint64(n), std::memory_order_relaxed);
+}
+
+#if defined(__GLIBC__)
+static const bool allocsComplete = true;
+extern "C" {
+void *__libc_malloc(size_t);
+void *__libc_calloc(size_t, size_t);
+void *__libc_realloc(void *, size_t);
+void *malloc(size_t n) { countAlloc(n); return __libc_malloc(n); }
+void *calloc(size_t n, size_t size) { countAlloc(n * size); return __libc_calloc(n, size); }
+void *realloc(void *p, size_t n) { countAlloc(n); return __libc_realloc(p, n); }
+}
+#else
+static const bool allocsComplete = false;
+void *operator new(size_t n)
+{
+    countAlloc(n);
+    if (void *p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t n) { return operator new(n); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+#endif
+
+/* ======== Previous implementation (reference) ======== */
+
+static inline bool legacyIsWhite(const QImage &img, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= img.width() || y >= img.height()) return false;
+    const QRgb c = img.pixel(x, y);
+    const int lum = int(0.2126*qRed(c) + 0.7152*qGreen(c) + 0.0722*qBlue(c));
+    return lum > 230;
+}
+
+static void legacyBuildGrid(const QImage &maze, int cellSize, QVector<QVector<bool>> &grid)
+{
+    const int gw = (maze.width()  + cellSize - 1) / cellSize;
+    const int gh = (maze.height() + cellSize - 1) / cellSize;
+
+    grid.resize(gh);
+    for (int gy = 0; gy < gh; ++gy) {
+        grid[gy].resize(gw);
+        for (int gx = 0; gx < gw; ++gx) {
+            int x0 = gx * cellSize;
+            int y0 = gy * cellSize;
+            int x1 = qMin(x0 + cellSize, maze.width());
+            int y1 = qMin(y0 + cellSize, maze.height());
+            int whiteCount = 0, total = 0;
+            for (int y = y0; y < y1; ++y)
+                for (int x = x0; x < x1; ++x) {
+                    ++total;
+                    if (legacyIsWhite(maze, x, y)) ++whiteCount;
+                }
+            double ratio = (total > 0) ? (double)whiteCount / (double)total : 0.0;
+            grid[gy][gx] = (ratio > 0.7);
+        }
+    }
+}
+
+static QVector<QPoint> legacyBfsPath(const QVector<QVector<bool>> &grid,
+                                     const QPoint &start, const QPoint &goal)
+{
+    const int gh = grid.size();
+    if (gh == 0) return {};
+    const int gw = grid[0].size();
+
+    auto idx = [gw](int x,int y){ return y*gw + x; };
+    QVector<int> dist(gw*gh, -1);
+    QVector<QPoint> parent(gw*gh, QPoint(-1,-1));
+
+    std::queue<QPoint> q;
+    q.push(start);
+    dist[idx(start.x(), start.y())] = 0;
+
+    const int dx[4] = {1,-1,0,0};
+    const int dy[4] = {0,0,1,-1};
+
+    while (!q.empty()) {
+        QPoint u = q.front(); q.pop();
+        if (u == goal) break;
+        for (int k = 0; k < 4; ++k) {
+            int nx = u.x() + dx[k];
+            int ny = u.y() + dy[k];
+            if (nx < 0 || ny < 0 || nx >= gw || ny >= gh) continue;
+            if (!grid[ny][nx]) continue;
+            int id = idx(nx,ny);
+            if (dist[id] != -1) continue;
+            dist[id] = dist[idx(u.x(),u.y())] + 1;
+            parent[id] = u;
+            q.push(QPoint(nx,ny));
+        }
+    }
+    if (dist[idx(goal.x(), goal.y())] == -1) return {};
+
+    QVector<QPoint> path;
+    for (QPoint v = goal; v != QPoint(-1,-1); v = parent[idx(v.x(),v.y())]) {
+        path.append(v);
+        if (v == start) break;
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+/* ======== Synthetic mazes ======== */
+
+static void fillRect(QImage &img, const QRect &r, QRgb c)
+{
+    const QRect rr = r.intersected(img.rect());
+    for (int y = rr.top(); y <= rr.bottom(); ++y) {
+        QRgb *row = reinterpret_cast<QRgb*>(img.scanLine(y));
+        std::fill(row + rr.left(), row + rr.right() + 1, c);
+    }
+}
+
+// Perfect maze (recursive backtracker) drawn as black walls on white,
+// with an opening in the top-left and bottom-right of the outer frame.
+static QImage makeMazeImage(int width, int height, int corridor, int wall)
+{
+    const int pitch = corridor + wall;
+    const int cols = qMax(1, (width  - wall) / pitch);
+    const int rows = qMax(1, (height - wall) / pitch);
+
+    QImage img(cols * pitch + wall, rows * pitch + wall, QImage::Format_RGB32);
+    img.fill(Qt::black);
+    const QRgb white = qRgb(255, 255, 255);
+
+    std::mt19937 rng(42);
+    QVector<uchar> seen(cols * rows, 0);
+    QVector<int> stack;
+    stack.append(0);
+    seen[0] = 1;
+
+    auto cellRect = [&](int c, int r) {
+        return QRect(wall + c * pitch, wall + r * pitch, corridor, corridor);
+    };
+    fillRect(img, cellRect(0, 0), white);
+
+    while (!stack.isEmpty()) {
+        const int cur = stack.last();
+        const int cx = cur % cols, cy = cur / cols;
+        int next[4], n = 0;
+        if (cx > 0        && !seen[cur - 1])    next[n++] = cur - 1;
+        if (cx < cols - 1 && !seen[cur + 1])    next[n++] = cur + 1;
+        if (cy > 0        && !seen[cur - cols]) next[n++] = cur - cols;
+        if (cy < rows - 1 && !seen[cur + cols]) next[n++] = cur + cols;
+        if (n == 0) { stack.removeLast(); continue; }
+
+        const int nb = next[rng() % n];
+        const int nx = nb % cols, ny = nb / cols;
+        seen[nb] = 1;
+        // open the new cell and knock down the wall between cur and nb
+        fillRect(img, cellRect(cx, cy).united(cellRect(nx, ny)), white);
+        stack.append(nb);
+    }
+
+    // entrance and exit
+    fillRect(img, QRect(wall, 0, corridor, wall), white);
+    fillRect(img, QRect(img.width() - wall - corridor, img.height() - wall, corridor, wall), white);
+    return img;
+}
+
+/* ======== Runner ======== */
+
+struct StageStats {
+    double bestMs = 1e300;
+    double totalMs = 0;
+    int runs = 0;
+    qint64 allocs = 0;      // per run (last run)
+    qint64 bytes = 0;
+};
+
+template <typename F>
+static StageStats measure(int runs, F &&fn)
+{
+    StageStats s;
+    for (int i = 0; i < runs; ++i) {
+        const qint64 n0 = allocCount.load(), b0 = allocBytes.load();
+        QElapsedTimer t; t.start();
+        fn();
+        const double ms = t.nsecsElapsed() / 1e6;
+        s.allocs = allocCount.load() - n0;
+        s.bytes = allocBytes.load() - b0;
+        s.bestMs = qMin(s.bestMs, ms);
+        s.totalMs += ms;
+        ++s.runs;
+    }
+    return s;
+}
+
+template <typename F>
+static double bestOfMs(int runs, F &&fn)
+{
+    return measure(runs, fn).bestMs;
+}
+
+static void printStage(QTextStream &out, const QString &name, const StageStats &s)
+{
+    out << QString("    %1 %2 %3 %4 %5\n")
+               .arg(name, -12)
+               .arg(s.bestMs, 10, 'f', 3)
+               .arg(s.totalMs / qMax(1, s.runs), 10, 'f', 3)
+               .arg(s.allocs, 8)
+               .arg(s.bytes / 1024.0, 12, 'f', 1);
+}
+
+static void runStages(QTextStream &out, const QString &name, const QImage &img,
+                      const QVector<int> &cellSizes, int runs)
+{
+    out << QString("%1  %2x%3 px\n").arg(name).arg(img.width()).arg(img.height());
+    out << QString("    %1 %2 %3 %4 %5\n").arg("stage", -12).arg("best ms", 10).arg("mean ms", 10)
+               .arg("allocs", 8).arg("alloc KiB", 12);
+
+    // stages that do not depend on the cell size
+    LumaPlane luma;
+    printStage(out, "luma", measure(runs, [&]{ luma = LumaPlane(img); }));
+    QRect bbox;
+    printStage(out, "bbox", measure(runs, [&]{ bbox = findMazeBBox(luma); }));
+    LumaPlane crop;
+    printStage(out, "crop", measure(runs, [&]{ crop = luma.cropped(bbox); }));
+    WhiteIntegral white;
+    printStage(out, "integral", measure(runs, [&]{ white = WhiteIntegral(crop); }));
+
+    auto solver = makeMazeSolver(MazeSolverKind::Bfs);
+    for (int cs : cellSizes) {
+        MazeGrid grid;
+        const StageStats build = measure(runs, [&]{ buildGrid(white, cs, grid); });
+        QPoint start, goal;
+        bool found = false;
+        const StageStats openings = measure(runs, [&]{ found = findOpenings(grid, start, goal); });
+        out << QString("  cell %1px  grid %2x%3\n").arg(cs).arg(grid.width()).arg(grid.height());
+        printStage(out, "buildGrid", build);
+        printStage(out, "openings", openings);
+        if (!found) {
+            out << "    no openings found\n";
+            continue;
+        }
+        blockBorderExcept(grid, start, goal);
+
+        QVector<QPoint> path;
+        printStage(out, solver->name().left(12), measure(runs, [&]{ path = solver->solve(grid, start, goal); }));
+        if (path.isEmpty()) {
+            out << "    no path found\n";
+            continue;
+        }
+        QVector<QPoint> route;
+        printStage(out, "corners", measure(runs, [&]{ route = routeCorners(path); }));
+        QString moves;
+        printStage(out, "moves", measure(runs, [&]{ moves = pathToMoves(route); }));
+        QVector<QPoint> smooth;
+        printStage(out, "smooth", measure(runs, [&]{ smooth = smoothRoute(grid, route); }));
+
+        // incremental repair: block one cell in the middle of the path
+        MazeReplanner replanner;
+        replanner.reset(grid, start, goal);
+        MazeSolveStats initial, repair;
+        replanner.replan(&initial);
+        replanner.moveStart(path[path.size() / 4]);
+        replanner.setBlocked(path[path.size() / 2]);
+        const bool stillSolvable = replanner.replan(&repair);
+        out << QString("    D* Lite     first search %1 ms, repair after one blocked cell %2 us "
+                       "(%3 cells updated)%4\n")
+                   .arg(initial.elapsedNs / 1e6, 0, 'f', 3).arg(repair.elapsedNs / 1e3, 0, 'f', 1)
+                   .arg(repair.nodesExpanded).arg(stillSolvable ? "" : ", no way left");
+
+        // the whole job as the GUI runs it, overlay included
+        MazeJobOptions opt;
+        opt.cellSizes = {cs};
+        MazeJobResult r;
+        printStage(out, "pipeline", measure(runs, [&]{ r = runMazePipeline(img, opt); }));
+        // the chat window draws at preview size and saves the full size later
+        QImage drawn;
+        printStage(out, "overlay full", measure(runs, [&]{ drawn = renderOverlay(img, r); }));
+        printStage(out, "overlay 720", measure(runs, [&]{ drawn = renderOverlay(img, r, QSize(720, 720)); }));
+        out << QString("    path %1 cells, %2 corners, %3 smoothed, moves %4 bytes%5\n")
+                   .arg(path.size()).arg(route.size()).arg(smooth.size()).arg(moves.size())
+                   .arg(r.ok ? "" : "  [pipeline: " + r.error + "]");
+    }
+    out.flush();
+}
+
+static void compareLegacy(QTextStream &out, const QString &name, const QImage &img, int cellSize, int runs)
+{
+    QVector<QVector<bool>> legacyGrid;
+    MazeGrid grid;
+
+    const double legacyBuild = bestOfMs(runs, [&]{ legacyBuildGrid(img, cellSize, legacyGrid); });
+    const double newBuild    = bestOfMs(runs, [&]{ buildGrid(img, cellSize, grid); });
+
+    QPoint start, goal;
+    if (!findOpenings(grid, start, goal)) {
+        out << name << ": no openings found, skipping BFS\n";
+        return;
+    }
+
+    QVector<QPoint> legacyPath, path;
+    const double legacyBfs = bestOfMs(runs, [&]{ legacyPath = legacyBfsPath(legacyGrid, start, goal); });
+    const double newBfs    = bestOfMs(runs, [&]{ path = bfsPath(grid, start, goal); });
+
+    out << QString("%1  legacy comparison (cell %2)%3\n").arg(name).arg(cellSize)
+               .arg(path == legacyPath ? "" : "  [MISMATCH]");
+    out << QString("  buildGrid  legacy %1 ms   MazeGrid %2 ms   x%3\n")
+               .arg(legacyBuild, 0, 'f', 2).arg(newBuild, 0, 'f', 2)
+               .arg(legacyBuild / qMax(newBuild, 1e-6), 0, 'f', 2);
+    out << QString("  bfsPath    legacy %1 ms   MazeGrid %2 ms   x%3\n")
+               .arg(legacyBfs, 0, 'f', 2).arg(newBfs, 0, 'f', 2)
+               .arg(legacyBfs / qMax(newBfs, 1e-6), 0, 'f', 2);
+    out.flush();
+}
+
+static QVector<int> intList(const QString &arg)
+{
+    QVector<int> values;
+    for (const QString &part : arg.split(',', Qt::SkipEmptyParts))
+        if (part.toInt() > 0) values.append(part.toInt());
+    return values;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    PerfStats::setEnabled(false); // its first records would show up as allocations
+    int runs = 5;
+    QVector<int> cellSizes {2, 3, 4, 6};
+    QVector<int> scales {100, 50, 25};
+    bool legacy = false;
+
+    // corpus: files and folders of images
+    QList<QPair<QString, QImage>> corpus;
+    const QStringList args = app.arguments().mid(1);
+    for (int i = 0; i < args.size(); ++i) {
+        const QString &a = args[i];
+        if (a == "--runs" && i + 1 < args.size())        runs = qMax(1, args[++i].toInt());
+        else if (a == "--cells" && i + 1 < args.size())  cellSizes = intList(args[++i]);
+        else if (a == "--scales" && i + 1 < args.size()) scales = intList(args[++i]);
+        else if (a == "--legacy")                        legacy = true;
+        else if (QFileInfo(a).isDir()) {
+            QStringList filters;
+            for (const QByteArray &fmt : QImageReader::supportedImageFormats())
+                filters << "*." + QString::fromLatin1(fmt);
+            const QDir dir(a);
+            for (const QString &f : dir.entryList(filters, QDir::Files, QDir::Name))
+                corpus.append({f, QImage(dir.filePath(f))});
+        } else {
+            corpus.append({QFileInfo(a).fileName(), QImage(a)});
+        }
+    }
+    if (corpus.isEmpty()) {
+        corpus.append({"synthetic-1080p", makeMazeImage(1920, 1080, 9, 3)});
+        corpus.append({"synthetic-4K", makeMazeImage(3840, 2160, 9, 3)});
+        corpus.append({"synthetic-8K", makeMazeImage(7680, 4320, 9, 3)});
+    }
+
+    out << QString("%1 runs per stage; allocations: %2\n\n").arg(runs)
+               .arg(allocsComplete ? "all heap allocations" : "operator new only");
+    for (const auto &entry : corpus) {
+        if (entry.second.isNull()) {
+            out << entry.first << ": could not load image\n";
+            continue;
+        }
+        for (int scale : scales) {
+            const QImage img = scale == 100 ? entry.second
+                                            : entry.second.scaledToWidth(entry.second.width() * scale / 100,
+                                                                         Qt::SmoothTransformation);
+            const QString name = QString("%1 @%2%").arg(entry.first).arg(scale);
+            runStages(out, name, img, cellSizes, runs);
+            if (legacy)
+                compareLegacy(out, name, img, 3, runs);
+            out << "\n";
+        }
+    }
+    return 0;
+}
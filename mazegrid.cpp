@@ -0,0 +1,366 @@
+#include "mazegrid.h"
+#include "mazesolver.h"
+#include "rowbands.h"
+
+#include <QHash>
+#include <algorithm>
+#include <climits>
+
+void MazeGrid::reset(int width, int height)
+{
+    w = qMax(0, width);
+    h = qMax(0, height);
+    cells.fill(0, (w + 2) * (h + 2));
+}
+
+QRect findMazeBBox(const LumaPlane &luma, int wallLum, int pad)
+{
+    const int W = luma.width(), H = luma.height();
+
+    // each band finds the dark extent of its rows, then the bands are merged
+    struct Extent { int minx, miny, maxx, maxy; };
+    const int bands = rowBandCount(H, W);
+    QVector<Extent> extents(bands, Extent{W, H, -1, -1});
+    Extent *out = extents.data(); // detach here, not on the workers
+    forEachRowBand(bands, H, [&](int band, int yBegin, int yEnd) {
+        Extent e = out[band];
+        for (int y = yBegin; y < yEnd; ++y) {
+            const uchar *row = luma.row(y);
+            // only the outermost dark pixels of a row matter
+            int x0 = 0;
+            while (x0 < W && row[x0] >= wallLum) ++x0;
+            if (x0 == W) continue;
+            int x1 = W - 1;
+            while (row[x1] >= wallLum) --x1;
+
+            if (x0 < e.minx) e.minx = x0;
+            if (x1 > e.maxx) e.maxx = x1;
+            if (y < e.miny) e.miny = y;
+            e.maxy = y;
+        }
+        out[band] = e;
+    });
+
+    int minx = W, miny = H, maxx = -1, maxy = -1;
+    for (const Extent &e : extents) {
+        if (e.maxx < 0) continue; // no dark pixel in this band
+        minx = qMin(minx, e.minx);
+        miny = qMin(miny, e.miny);
+        maxx = qMax(maxx, e.maxx);
+        maxy = qMax(maxy, e.maxy);
+    }
+    if (maxx < 0) return QRect(0, 0, W, H); // fallback
+    minx = qMax(0, minx - pad);
+    miny = qMax(0, miny - pad);
+    maxx = qMin(W-1, maxx + pad);
+    maxy = qMin(H-1, maxy + pad);
+    return QRect(QPoint(minx,miny), QPoint(maxx,maxy));
+}
+
+WhiteIntegral::WhiteIntegral(const LumaPlane &luma, int whiteLum)
+    : w(luma.width()), h(luma.height())
+{
+    const int s = w + 1;
+    sums.fill(0, s * (h + 1));
+    quint32 *t = sums.data();
+
+    // Pass 1: every band is summed as if it started at the top of the image.
+    const int bands = rowBandCount(h, w);
+    forEachRowBand(bands, h, [&](int, int yBegin, int yEnd) {
+        const QVector<quint32> zero(s, 0);
+        for (int y = yBegin; y < yEnd; ++y) {
+            const uchar *p = luma.row(y);
+            const quint32 *above = y == yBegin ? zero.constData() : t + qsizetype(y) * s;
+            quint32 *cur = t + qsizetype(y + 1) * s;
+            quint32 rowSum = 0;
+            for (int x = 0; x < w; ++x) {
+                rowSum += p[x] > whiteLum;
+                cur[x + 1] = above[x + 1] + rowSum;
+            }
+        }
+    });
+    if (bands == 1) return;
+
+    // Pass 2: add the total of all bands above. The carries are prefix sums
+    // of the bands' last rows; integer adds, so the table equals the serial one.
+    QVector<quint32> carry(qsizetype(bands) * s, 0);
+    for (int b = 1; b < bands; ++b) {
+        const int lastRow = int(qint64(b) * h / bands);   // last row of band b-1, in table rows
+        const quint32 *prev = carry.constData() + qsizetype(b - 1) * s;
+        const quint32 *local = t + qsizetype(lastRow) * s;
+        quint32 *c = carry.data() + qsizetype(b) * s;
+        for (int x = 0; x < s; ++x)
+            c[x] = prev[x] + local[x];
+    }
+    forEachRowBand(bands, h, [&](int band, int yBegin, int yEnd) {
+        if (band == 0) return;
+        const quint32 *c = carry.constData() + qsizetype(band) * s;
+        for (int y = yBegin; y < yEnd; ++y) {
+            quint32 *cur = t + qsizetype(y + 1) * s;
+            for (int x = 0; x < s; ++x)
+                cur[x] += c[x];
+        }
+    });
+}
+
+void buildGrid(const WhiteIntegral &white, int cellSize, MazeGrid &grid)
+{
+    const int W = white.width(), H = white.height();
+    const int gw = (W + cellSize - 1) / cellSize;
+    const int gh = (H + cellSize - 1) / cellSize;
+
+    grid.reset(gw, gh);
+    uchar *cells = grid.rowData(0);
+    const int stride = grid.stride();
+    // grid rows are independent: bands of them are filled in parallel
+    forEachRowBand(rowBandCount(gh, gw * 4), gh, [&](int, int gyBegin, int gyEnd) {
+        for (int gy = gyBegin; gy < gyEnd; ++gy) {
+            const int y0 = gy * cellSize;
+            const int y1 = qMin(y0 + cellSize, H);
+            uchar *row = cells + qsizetype(gy) * stride;
+            for (int gx = 0; gx < gw; ++gx) {
+                const int x0 = gx * cellSize;
+                const int x1 = qMin(x0 + cellSize, W);
+                const quint32 total = quint32((x1 - x0) * (y1 - y0));
+                // require MOST of the cell to be white to be considered free (>70%)
+                row[gx] = (white.count(x0, y0, x1, y1) * 10 > total * 7) ? 1 : 0;
+            }
+        }
+    });
+}
+
+void buildGrid(const LumaPlane &maze, int cellSize, MazeGrid &grid)
+{
+    buildGrid(WhiteIntegral(maze), cellSize, grid);
+}
+
+void buildGrid(const QImage &maze, int cellSize, MazeGrid &grid)
+{
+    buildGrid(LumaPlane(maze), cellSize, grid);
+}
+
+// Union-find over padded cell indices, with path halving
+static qint32 findRoot(QVector<qint32> &parent, qint32 v)
+{
+    while (parent[v] != v) {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+    }
+    return v;
+}
+
+QVector<MazeOpening> findBorderOpenings(const MazeGrid &grid)
+{
+    QVector<MazeOpening> openings;
+    const int gw = grid.width(), gh = grid.height();
+    if (gw < 3 || gh < 3) return openings;
+
+    // Label the free interior in one raster pass: union with the free
+    // neighbours to the left and above.
+    QVector<qint32> parent(grid.cellCount());
+    const uchar *cells = grid.data();
+    const int s = grid.stride();
+    for (int y = 1; y < gh - 1; ++y) {
+        for (int x = 1; x < gw - 1; ++x) {
+            const qint32 i = grid.index(x, y);
+            parent[i] = i;
+            if (!cells[i]) continue;
+            if (x > 1 && cells[i - 1]) parent[findRoot(parent, i)] = findRoot(parent, i - 1);
+            if (y > 1 && cells[i - s]) {
+                const qint32 a = findRoot(parent, i), b = findRoot(parent, i - s);
+                if (a != b) parent[a] = b;
+            }
+        }
+    }
+
+    // the border, clockwise from the top-left corner
+    QVector<QPoint> ring;
+    ring.reserve(2 * (gw + gh) - 4);
+    for (int x = 0; x < gw; ++x)       ring.append(QPoint(x, 0));
+    for (int y = 1; y < gh; ++y)       ring.append(QPoint(gw - 1, y));
+    for (int x = gw - 2; x >= 0; --x)  ring.append(QPoint(x, gh - 1));
+    for (int y = gh - 2; y >= 1; --y)  ring.append(QPoint(0, y));
+    const int n = ring.size();
+
+    // start just after a blocked cell so no run wraps around the end
+    int first = 0;
+    while (first < n && grid.isFree(ring[first])) ++first;
+    if (first == n) return openings; // no wall at all on the border
+
+    auto inward = [&](const QPoint &p) {
+        if (p.y() == 0)      return QPoint(p.x(), 1);
+        if (p.y() == gh - 1) return QPoint(p.x(), gh - 2);
+        if (p.x() == 0)      return QPoint(1, p.y());
+        return QPoint(gw - 2, p.y());
+    };
+    auto isCorner = [&](const QPoint &p) {
+        return (p.x() == 0 || p.x() == gw - 1) && (p.y() == 0 || p.y() == gh - 1);
+    };
+
+    int runs = 0;
+    for (int k = 1; k <= n; ) {
+        const QPoint p = ring[(first + k) % n];
+        if (!grid.isFree(p)) { ++k; continue; }
+        int len = 0;
+        while (k + len <= n && grid.isFree(ring[(first + k + len) % n])) ++len;
+
+        // per region behind the run, the cell nearest the middle leading into it
+        const int firstOfRun = openings.size();
+        QVector<int> bestOff;
+        for (int j = 0; j < len; ++j) {
+            const QPoint c = ring[(first + k + j) % n];
+            if (isCorner(c)) continue; // a corner has no cell straight inside
+            const QPoint in = inward(c);
+            if (!grid.isFree(in)) continue;
+            const int component = findRoot(parent, grid.index(in.x(), in.y()));
+            const int off = qAbs(2 * j - (len - 1));
+            int o = firstOfRun;
+            while (o < openings.size() && openings[o].component != component) ++o;
+            if (o == openings.size()) {
+                openings.append(MazeOpening{c, len, runs, component});
+                bestOff.append(off);
+            } else if (off < bestOff[o - firstOfRun]) {
+                openings[o].center = c;
+                bestOff[o - firstOfRun] = off;
+            }
+        }
+        ++runs;
+        k += len;
+    }
+    return openings;
+}
+
+bool findOpenings(const MazeGrid &grid, QPoint &start, QPoint &goal)
+{
+    const QVector<MazeOpening> openings = findBorderOpenings(grid);
+
+    // only openings into the same region can be joined by a path
+    int best = -1;
+    for (int i = 0; i < openings.size(); ++i) {
+        for (int j = i + 1; j < openings.size(); ++j) {
+            if (openings[i].component != openings[j].component || openings[i].run == openings[j].run)
+                continue;
+            const QPoint d = openings[j].center - openings[i].center;
+            const int dist = qAbs(d.x()) + qAbs(d.y());
+            if (dist > best) {
+                best = dist;
+                start = openings[i].center;
+                goal = openings[j].center;
+            }
+        }
+    }
+    return best >= 0;
+}
+
+void blockBorderExcept(MazeGrid &grid, const QPoint &start, const QPoint &goal)
+{
+    if (grid.isEmpty()) return;
+    const int gh = grid.height();
+    const int gw = grid.width();
+
+    const bool startFree = grid.contains(start) && grid.isFree(start);
+    const bool goalFree  = grid.contains(goal)  && grid.isFree(goal);
+
+    for (int x = 0; x < gw; ++x) {
+        grid.setFree(x, 0, false);
+        grid.setFree(x, gh - 1, false);
+    }
+    for (int y = 0; y < gh; ++y) {
+        grid.setFree(0, y, false);
+        grid.setFree(gw - 1, y, false);
+    }
+
+    if (startFree) grid.setFree(start.x(), start.y(), true);
+    if (goalFree)  grid.setFree(goal.x(), goal.y(), true);
+}
+
+QVector<QPoint> bfsPath(const MazeGrid &grid, const QPoint &start, const QPoint &goal)
+{
+    if (grid.isEmpty() || !grid.contains(start) || !grid.contains(goal)) return {};
+
+    const int s = grid.index(start.x(), start.y());
+    const int g = grid.index(goal.x(), goal.y());
+    const uchar *cells = grid.data();
+
+    // parent doubles as the visited marker; the start points at itself
+    QVector<int> parent(grid.cellCount(), -1);
+    QVector<int> queue(grid.cellCount());
+    int head = 0, tail = 0;
+
+    queue[tail++] = s;
+    parent[s] = s;
+
+    const int off[4] = {grid.offset(0), grid.offset(1), grid.offset(2), grid.offset(3)};
+
+    while (head < tail) {
+        const int u = queue[head++];
+        if (u == g) break;
+
+        for (int k = 0; k < 4; ++k) {
+            const int v = u + off[k];
+            if (!cells[v] || parent[v] != -1) continue; // border is never free
+            parent[v] = u;
+            queue[tail++] = v;
+        }
+    }
+
+    if (parent[g] == -1) {
+        return {}; // no path
+    }
+
+    QVector<QPoint> path;
+    for (int v = g; ; v = parent[v]) {
+        path.append(grid.point(v));
+        if (v == s) break;
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+size_t mazeGridHash(const MazeGrid &grid)
+{
+    return qHashBits(grid.data(), size_t(grid.cellCount()), size_t(grid.width()) * 65599u + size_t(grid.height()));
+}
+
+bool solveOverCellSizes(const WhiteIntegral &white, const QVector<int> &cellSizes, MazeSweep &out,
+                        MazeSolver *solver, const std::function<bool()> &cancelled)
+{
+    out = MazeSweep();
+    MazeGrid grid;
+    for (int cellSize : cellSizes) {
+        if (cancelled && cancelled()) return false;
+        if (cellSize < 1) continue;
+        buildGrid(white, cellSize, grid);
+        const size_t hash = mazeGridHash(grid);
+        if (out.hashCellSize == 0) {
+            out.gridHash = hash;
+            out.hashCellSize = cellSize;
+        }
+
+        QPoint start, goal;
+        if (!findOpenings(grid, start, goal)) continue;
+        out.foundOpenings = true;
+
+        blockBorderExcept(grid, start, goal);
+        QVector<QPoint> path;
+        if (solver) {
+            MazeSolveStats stats;
+            path = solver->solve(grid, start, goal, &stats);
+            out.nodesExpanded += stats.nodesExpanded;
+            out.solveNs += stats.elapsedNs;
+        } else {
+            path = bfsPath(grid, start, goal);
+        }
+        if (path.isEmpty()) continue;
+
+        out.cellSize = cellSize;
+        out.gridHash = hash;
+        out.hashCellSize = cellSize;
+        out.grid = grid;
+        out.start = start;
+        out.goal = goal;
+        out.path = path;
+        return true;
+    }
+    return false;
+}
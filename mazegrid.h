@@ -0,0 +1,141 @@
+#pragma once
+#include "lumaplane.h"
+
+#include <QImage>
+#include <QPoint>
+#include <QVector>
+#include <functional>
+
+// Occupancy grid shared by every maze stage.
+// One byte per cell in a single contiguous buffer, surrounded by a one-cell
+// border that is always blocked. Neighbour checks therefore never need a
+// bounds test: stepping off the maze lands on a blocked border cell.
+class MazeGrid {
+public:
+    MazeGrid() = default;
+    MazeGrid(int width, int height) { reset(width, height); }
+
+    // Resize to width x height, every cell blocked
+    void reset(int width, int height);
+
+    int width() const  { return w; }
+    int height() const { return h; }
+    bool isEmpty() const { return w <= 0 || h <= 0; }
+
+    // Padded layout: row length and total number of stored cells
+    int stride() const    { return w + 2; }
+    int cellCount() const { return int(cells.size()); }
+
+    // Index of interior cell (x,y) in the padded buffer and back
+    int index(int x, int y) const { return (y + 1) * stride() + (x + 1); }
+    QPoint point(int i) const     { return QPoint(i % stride() - 1, i / stride() - 1); }
+
+    bool contains(const QPoint &p) const { return p.x() >= 0 && p.y() >= 0 && p.x() < w && p.y() < h; }
+
+    bool isFree(int x, int y) const     { return cells[index(x, y)] != 0; }
+    bool isFree(const QPoint &p) const  { return isFree(p.x(), p.y()); }
+    bool isFreeAt(int i) const          { return cells[i] != 0; }
+    void setFree(int x, int y, bool free) { cells[index(x, y)] = free ? 1 : 0; }
+
+    // Raw access for tight loops. rowData(y) points at interior cell (0,y).
+    const uchar *data() const { return cells.constData(); }
+    uchar *rowData(int y)     { return cells.data() + index(0, y); }
+
+    // Index offsets to the E, W, S and N neighbours of a cell
+    int offset(int k) const {
+        const int s = stride();
+        const int d[4] = {1, -1, s, -s};
+        return d[k];
+    }
+
+    bool operator==(const MazeGrid &o) const { return w == o.w && h == o.h && cells == o.cells; }
+    bool operator!=(const MazeGrid &o) const { return !(*this == o); }
+
+private:
+    int w = 0;
+    int h = 0;
+    QVector<uchar> cells;
+};
+
+// Summed-area table of the white (lum > 230) pixels of a maze.
+// Built once per maze; the white count of any rectangle is four lookups,
+// so grids for several cell sizes can be built without re-scanning pixels.
+class WhiteIntegral {
+public:
+    WhiteIntegral() = default;
+    explicit WhiteIntegral(const LumaPlane &luma, int whiteLum = 230);
+
+    int width() const  { return w; }
+    int height() const { return h; }
+
+    // Number of white pixels in [x0,x1) x [y0,y1)
+    quint32 count(int x0, int y0, int x1, int y1) const {
+        const int s = w + 1;
+        const quint32 *t = sums.constData();
+        return t[y1*s + x1] - t[y0*s + x1] - t[y1*s + x0] + t[y0*s + x0];
+    }
+
+private:
+    int w = 0;
+    int h = 0;
+    QVector<quint32> sums; // (w+1) x (h+1), first row and column are zero
+};
+
+// Bounding box of the dark maze frame (lum < wallLum), padded by pad pixels
+QRect findMazeBBox(const LumaPlane &luma, int wallLum = 200, int pad = 2);
+
+// Build a coarse grid by sampling the maze luminance (lum > 230 is free space)
+void buildGrid(const LumaPlane &maze, int cellSize, MazeGrid &grid);
+void buildGrid(const QImage &maze, int cellSize, MazeGrid &grid);
+void buildGrid(const WhiteIntegral &white, int cellSize, MazeGrid &grid);
+
+// One gap in the border of the grid: a run of adjacent free border cells
+// and a connected region of the interior behind it
+struct MazeOpening {
+    QPoint center;      // cell of the run nearest its middle that leads into the region
+    int size = 0;       // free border cells in the run
+    int run = 0;        // which run; a wide run can open into several regions
+    int component = -1; // connected region of the interior
+};
+
+// Openings in clockwise border order from the top-left corner, one per run
+// and region; runs that lead nowhere (no free cell inside) are left out
+QVector<MazeOpening> findBorderOpenings(const MazeGrid &grid);
+
+// Pick start and goal: the two openings of different runs furthest apart
+// that open into the same connected region, so the solve always has a
+// path. False if there is no such pair.
+bool findOpenings(const MazeGrid &grid, QPoint &start, QPoint &goal);
+
+// Block all border cells except start & goal
+void blockBorderExcept(MazeGrid &grid, const QPoint &start, const QPoint &goal);
+
+// BFS on grid -> list of grid cells from start to goal
+QVector<QPoint> bfsPath(const MazeGrid &grid, const QPoint &start, const QPoint &goal);
+
+// Cheap identity of a grid, used to skip re-solving identical frames
+size_t mazeGridHash(const MazeGrid &grid);
+
+class MazeSolver;
+
+// Grid + path for the first cell size (in order of preference) that solves
+struct MazeSweep {
+    int cellSize = 0;
+    MazeGrid grid;
+    QPoint start, goal;
+    QVector<QPoint> path;
+    bool foundOpenings = false; // at least one cell size had two openings
+    int nodesExpanded = 0;      // summed over every cell size tried
+    qint64 solveNs = 0;
+    // mazeGridHash of the grid as built (before blocking the border) at
+    // hashCellSize: the size that solved, else the first size tried
+    size_t gridHash = 0;
+    int hashCellSize = 0;
+};
+
+// Try each cell size on the same integral image and keep the first one
+// that yields a path. Uses bfsPath unless a solver is given; cancelled is
+// polled between cell sizes. Returns false if none of them is solvable.
+bool solveOverCellSizes(const WhiteIntegral &white, const QVector<int> &cellSizes, MazeSweep &out,
+                        MazeSolver *solver = nullptr,
+                        const std::function<bool()> &cancelled = {});
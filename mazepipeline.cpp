@@ -0,0 +1,294 @@
+#include "mazepipeline.h"
+#include "perfstats.h"
+
+#include <QByteArray>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPen>
+
+QVector<QPoint> routeCorners(const QVector<QPoint> &gridPath)
+{
+    if (gridPath.size() < 3)
+        return gridPath;
+    QVector<QPoint> route;
+    route.append(gridPath.first());
+    for (int i = 1; i + 1 < gridPath.size(); ++i) {
+        // keep a point where the direction changes
+        if (gridPath[i] - gridPath[i - 1] != gridPath[i + 1] - gridPath[i])
+            route.append(gridPath[i]);
+    }
+    route.append(gridPath.last());
+    return route;
+}
+
+bool lineOfSight(const MazeGrid &grid, const QPoint &a, const QPoint &b)
+{
+    // walk every cell the segment touches (integer grid traversal)
+    const int nx = qAbs(b.x() - a.x()), ny = qAbs(b.y() - a.y());
+    const int sx = b.x() > a.x() ? 1 : -1, sy = b.y() > a.y() ? 1 : -1;
+    int x = a.x(), y = a.y();
+    if (!grid.isFree(x, y)) return false;
+    for (int ix = 0, iy = 0; ix < nx || iy < ny; ) {
+        const int decision = (1 + 2 * ix) * ny - (1 + 2 * iy) * nx;
+        if (decision == 0) {
+            // exactly through a corner: no squeezing between two walls
+            if (!grid.isFree(x + sx, y) || !grid.isFree(x, y + sy)) return false;
+            x += sx; y += sy; ++ix; ++iy;
+        } else if (decision < 0) {
+            x += sx; ++ix;
+        } else {
+            y += sy; ++iy;
+        }
+        if (!grid.isFree(x, y)) return false;
+    }
+    return true;
+}
+
+QVector<QPoint> smoothRoute(const MazeGrid &grid, const QVector<QPoint> &route)
+{
+    if (route.size() < 3)
+        return route;
+    QVector<QPoint> out;
+    out.append(route.first());
+    int anchor = 0;
+    for (int i = 1; i + 1 < route.size(); ++i) {
+        if (!lineOfSight(grid, route[anchor], route[i + 1])) {
+            out.append(route[i]);
+            anchor = i;
+        }
+    }
+    out.append(route.last());
+    return out;
+}
+
+QVector<MazeMove> pathToMoveList(const QVector<QPoint> &route)
+{
+    QVector<MazeMove> moves;
+    if (route.size() < 2)
+        return moves;
+
+    auto dirFromDelta = [](int dx, int dy)->char {
+        if (dx > 0 && dy == 0) return 'E';
+        if (dx < 0 && dy == 0) return 'W';
+        if (dx == 0 && dy > 0) return 'S';
+        if (dx == 0 && dy < 0) return 'N';
+        return '?';
+    };
+
+    QPoint prev = route[0];
+    for (int i = 1; i < route.size(); ++i) {
+        const QPoint d = route[i] - prev;
+        const char dir = dirFromDelta(d.x(), d.y());
+        prev = route[i];
+        if (dir == '?')
+            continue; // skip weird jumps
+        const int steps = qAbs(d.x()) + qAbs(d.y());
+        if (!moves.isEmpty() && moves.last().dir == dir)
+            moves.last().steps += steps;
+        else
+            moves.append({dir, steps});
+    }
+    return moves;
+}
+
+QString pathToMoves(const QVector<QPoint> &route)
+{
+    if (route.size() < 2)
+        return "{}";
+    const QVector<MazeMove> moves = pathToMoveList(route);
+
+    // [{"dir":"E","steps":5}, ...] written into one buffer
+    QByteArray json;
+    json.reserve(2 + moves.size() * 24);
+    json += '[';
+    for (int i = 0; i < moves.size(); ++i) {
+        if (i) json += ',';
+        json += "{\"dir\":\"";
+        json += moves[i].dir;
+        json += "\",\"steps\":";
+        json += QByteArray::number(moves[i].steps);
+        json += '}';
+    }
+    json += ']';
+    return QString::fromLatin1(json);
+}
+
+QVector<QPointF> pathToImagePoints(const QVector<QPoint> &gridPath, const QRect &bbox, int cellSize)
+{
+    // grid cell centre -> normalized [0,1] inside the crop -> source pixels
+    QVector<QPointF> points;
+    points.reserve(gridPath.size());
+    const double w = bbox.width() - 1;
+    const double h = bbox.height() - 1;
+    for (const QPoint &c : gridPath) {
+        double cx = (c.x() + 0.5) * cellSize;
+        double cy = (c.y() + 0.5) * cellSize;
+        // clamp inside image
+        cx = qBound(0.0, cx, w - 1.0);
+        cy = qBound(0.0, cy, h - 1.0);
+        double nx = cx / (w - 1.0);
+        double ny = cy / (h - 1.0);
+        points.append(QPointF(bbox.x() + nx * w, bbox.y() + ny * h));
+    }
+    return points;
+}
+
+QImage renderOverlay(const QImage &img, const MazeJobResult &r, const QSize &fit)
+{
+    if (img.isNull()) return QImage();
+    QImage base = img;
+    double scale = 1.0;
+    if (!fit.isEmpty() && (img.width() > fit.width() || img.height() > fit.height())) {
+        const QSize target = img.size().scaled(fit, Qt::KeepAspectRatio);
+        // halve cheaply while far too big, smooth only the last step
+        while (base.width() >= 2 * target.width() && base.height() >= 2 * target.height())
+            base = base.scaled(base.size() / 2, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+        base = base.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        scale = double(target.width()) / img.width();
+    }
+    // the format QPainter draws on fastest
+    QImage out = base.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    const QVector<QPointF> points = pathToImagePoints(r.smoothRoute.isEmpty() ? r.route : r.smoothRoute,
+                                                      r.bbox, r.cellSize);
+    if (points.size() < 2) return out;
+    QPainterPath route(points.first() * scale);
+    for (int i = 1; i < points.size(); ++i)
+        route.lineTo(points[i] * scale);
+
+    QPainter p(&out);
+    QPen pen(Qt::red);
+    pen.setWidth(qMax(3, out.width()/200));
+    pen.setCapStyle(Qt::RoundCap);
+    pen.setJoinStyle(Qt::RoundJoin);
+    p.setRenderHint(QPainter::Antialiasing, true);
+    p.setPen(pen);
+    p.drawPath(route);
+    return out;
+}
+
+bool saveOverlay(const QImage &img, const MazeJobResult &r, const QString &path, const char *format, int quality)
+{
+    PerfScope scope("maze.save");
+    return renderOverlay(img, r).save(path, format, quality);
+}
+
+static QString statsLine(const QString &name, int nodes, qint64 ns, int length, const MazeJobResult &r)
+{
+    return QString("%1: %2 cells, %3 nodes expanded, %4 ms (grid %5x%6, cell %7px)")
+        .arg(name).arg(length).arg(nodes).arg(ns / 1e6, 0, 'f', 2)
+        .arg(r.grid.width()).arg(r.grid.height()).arg(r.cellSize);
+}
+
+MazeJobResult runMazePipeline(const QImage &img, const MazeJobOptions &opt, const MazeProgress &progress)
+{
+    MazeJobResult r;
+    auto step = [&](int percent) {
+        if (!progress || progress(percent)) return true;
+        r.error = "Cancelled.";
+        return false;
+    };
+
+    if (img.isNull()) { r.error = "Could not load image."; return r; }
+    PerfScope total("maze.pipeline");
+    PerfScope stage("maze.luma");
+
+    // one luminance pass shared by cropping and grid building
+    const LumaPlane luma(img);
+    if (!step(15)) return r;
+
+    // crop to the maze frame
+    stage.next("maze.crop");
+    r.bbox = findMazeBBox(luma);
+    const WhiteIntegral white(luma.cropped(r.bbox));
+    if (!step(35)) return r;
+
+    // Live mode: nothing to do if the binarized maze did not change. Only
+    // then is a probe grid built; otherwise the sweep hashes its own grids.
+    if (opt.previousGridHash != 0) {
+        stage.next("maze.hash");
+        r.cellSize = opt.previousCellSize > 0 ? opt.previousCellSize : opt.cellSizes.value(0, 3);
+        MazeGrid probe;
+        buildGrid(white, r.cellSize, probe);
+        r.gridHash = mazeGridHash(probe);
+        if (r.gridHash == opt.previousGridHash) {
+            r.ok = true;
+            r.unchanged = true;
+            return r;
+        }
+    }
+
+    // ---- build coarse grid and solve ----
+    // Try cell sizes in order of preference (3 is the tuned default)
+    // and keep the first one that solves.
+    stage.next("maze.solve");
+    auto solver = makeMazeSolver(opt.solver);
+    MazeSweep sweep;
+    const bool solved = solveOverCellSizes(white, opt.cellSizes, sweep, solver.get(),
+                                           [&]{ return progress && !progress(35); });
+    if (!step(70)) return r;
+    if (!solved) {
+        // identical unsolvable frames are skipped next time too
+        if (r.gridHash == 0) {
+            r.gridHash = sweep.gridHash;
+            r.cellSize = sweep.hashCellSize;
+        }
+        r.error = sweep.foundOpenings ? "No path found by " + solver->name() + "."
+                                      : "Could not find maze entrances.";
+        return r;
+    }
+
+    stage.next("maze.route");
+    r.gridHash = sweep.gridHash;
+    r.solverName = solver->name();
+    r.cellSize = sweep.cellSize;
+    r.grid = sweep.grid;
+    r.start = sweep.start;
+    r.goal = sweep.goal;
+    r.gridPath = sweep.path;
+    r.route = routeCorners(r.gridPath);
+    if (opt.smoothRoute)
+        r.smoothRoute = smoothRoute(r.grid, r.route);
+    if (opt.distanceField)
+        r.distances = DistanceField(r.grid, r.goal);
+    r.movesJson = pathToMoves(r.route);
+
+    if (!opt.compareAll) {
+        r.log << statsLine(solver->name(), sweep.nodesExpanded, sweep.solveNs, r.gridPath.size(), r);
+    } else {
+        // same grid for every solver so the numbers are comparable
+        for (MazeSolverKind kind : {MazeSolverKind::Bfs, MazeSolverKind::BidirectionalBfs, MazeSolverKind::AStar}) {
+            auto s = makeMazeSolver(kind);
+            MazeSolveStats stats;
+            const QVector<QPoint> p = s->solve(r.grid, r.start, r.goal, &stats);
+            r.log << statsLine(s->name(), stats.nodesExpanded, stats.elapsedNs, p.size(), r);
+        }
+    }
+    if (!step(80)) return r;
+
+    if (!opt.drawOverlay) {
+        r.ok = true;
+        step(100);
+        return r;
+    }
+
+    // Draw overlay (at display size unless asked for full resolution)
+    stage.next("maze.overlay");
+    r.overlay = renderOverlay(img, r, opt.overlaySize);
+    if (opt.keepSource)
+        r.source = img;
+    if (!step(90)) return r;
+
+    // Save
+    if (!opt.savePath.isEmpty()) {
+        stage.next("maze.save");
+        const QImage full = opt.overlaySize.isEmpty() ? r.overlay : renderOverlay(img, r);
+        if (full.save(opt.savePath, opt.saveFormat.isEmpty() ? nullptr : opt.saveFormat.constData(),
+                      opt.saveQuality))
+            r.savedPath = opt.savePath;
+    }
+
+    r.ok = true;
+    step(100);
+    return r;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "mazegrid.h"
+#include "mazesolver.h"
+
+#include <QByteArray>
+#include <QImage>
+#include <QPointF>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+struct MazeJobOptions {
+    MazeSolverKind solver = MazeSolverKind::Bfs;
+    bool compareAll = false;                 // also run every solver and report
+    QVector<int> cellSizes {3, 2, 4, 5, 6};  // tried in this order
+    bool drawOverlay = true;                 // paint the path onto a copy of the image
+    QSize overlaySize;                       // ... scaled to fit this (empty: full resolution)
+    QString savePath;                        // save a full-resolution overlay here (empty: don't)
+    QByteArray saveFormat;                   // "PNG", "JPG", ... (empty: from the file suffix)
+    int saveQuality = -1;                    // QImage::save quality; for PNG 0 is the smallest file
+    bool keepSource = false;                 // return the source image in r.source (for a later save)
+    bool smoothRoute = false;                // also build the any-angle route and draw that
+    bool distanceField = false;              // also build r.distances (re-routing from any cell)
+
+    // Live solving: if the grid at previousCellSize still hashes to
+    // previousGridHash, skip the solve and return with unchanged = true.
+    size_t previousGridHash = 0;
+    int previousCellSize = 0;                // 0: first entry of cellSizes
+};
+
+struct MazeJobResult {
+    bool ok = false;
+    QString error;               // set when !ok
+    QRect bbox;                  // maze frame inside the source image
+    int cellSize = 0;
+    MazeGrid grid;               // border blocked except start & goal
+    QPoint start, goal;
+    QVector<QPoint> gridPath;    // every cell, as the solver returned it
+    QVector<QPoint> route;       // start, corners and goal of gridPath
+    QVector<QPoint> smoothRoute; // any-angle route (only with opt.smoothRoute)
+    DistanceField distances;     // to the goal on grid (only with opt.distanceField)
+    QString movesJson;
+    QImage overlay;              // source image with the path drawn on it (at opt.overlaySize)
+    QImage source;               // the source image (only with opt.keepSource)
+    QString savedPath;           // set if the overlay was saved
+    QStringList log;             // per-solver stats lines
+    QString solverName;          // solver that found gridPath
+    size_t gridHash = 0;         // hash of the (unblocked) grid at cellSize
+    bool unchanged = false;      // grid matched previousGridHash, nothing solved
+};
+
+// Progress hook, called with 0..100 between stages. Return false to cancel.
+using MazeProgress = std::function<bool(int percent)>;
+
+// Crop, grid, solve and draw. Pure Qt::Gui code, safe to run on any thread.
+MazeJobResult runMazePipeline(const QImage &img, const MazeJobOptions &opt,
+                              const MazeProgress &progress = {});
+
+// Source image with the route of r drawn on it as one path, scaled to fit
+// fit (full resolution if fit is empty). Uses r.smoothRoute if there is one.
+QImage renderOverlay(const QImage &img, const MazeJobResult &r, const QSize &fit = QSize());
+
+// Full-resolution overlay written to path; format and quality as in QImage::save
+bool saveOverlay(const QImage &img, const MazeJobResult &r, const QString &path,
+                 const char *format = nullptr, int quality = -1);
+
+// Path cells mapped to pixel coordinates of the source image
+QVector<QPointF> pathToImagePoints(const QVector<QPoint> &gridPath, const QRect &bbox, int cellSize);
+
+// Compact route: the start, every corner and the goal. Consecutive points
+// share a row or a column, so a path of thousands of cells usually becomes
+// a few dozen points. Every function below accepts either form.
+QVector<QPoint> routeCorners(const QVector<QPoint> &gridPath);
+
+// Any-angle route: corners are dropped while the straight line between the
+// remaining neighbours only crosses free cells. For drawing; the car drives
+// the corner route.
+QVector<QPoint> smoothRoute(const MazeGrid &grid, const QVector<QPoint> &route);
+
+// Straight segment between two cell centres crosses free cells only
+// (through a cell corner, both cells beside it must be free)
+bool lineOfSight(const MazeGrid &grid, const QPoint &a, const QPoint &b);
+
+// Run-length moves in compass directions (N is up in the image)
+struct MazeMove {
+    char dir;   // 'N', 'E', 'S' or 'W'
+    int steps;  // grid cells
+};
+QVector<MazeMove> pathToMoveList(const QVector<QPoint> &route);
+
+// Run-length moves: [{"dir":"E","steps":5}, ...]
+QString pathToMoves(const QVector<QPoint> &route);
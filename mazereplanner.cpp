@@ -0,0 +1,220 @@
+#include "mazereplanner.h"
+
+#include <QElapsedTimer>
+
+static const qint32 kInf = 1 << 29; // sums of two stay below INT_MAX
+
+void MazeReplanner::reset(const MazeGrid &grid, const QPoint &startCell, const QPoint &goalCell)
+{
+    map = grid;
+    g.clear();
+    heap.clear();
+    if (map.isEmpty() || !map.contains(startCell) || !map.contains(goalCell)) return;
+
+    const int n = map.cellCount();
+    g.fill(kInf, n);
+    rhs.fill(kInf, n);
+    heapPos.fill(-1, n);
+    for (int k = 0; k < 4; ++k) off[k] = map.offset(k);
+
+    startIndex = lastStart = map.index(startCell.x(), startCell.y());
+    goalIndex = map.index(goalCell.x(), goalCell.y());
+    km = 0;
+    if (map.isFreeAt(goalIndex)) {
+        rhs[goalIndex] = 0;
+        heapPush(goalIndex, calcKey(goalIndex));
+    }
+}
+
+int MazeReplanner::heuristic(qint32 a, qint32 b) const
+{
+    const int s = map.stride();
+    return qAbs(a % s - b % s) + qAbs(a / s - b / s);
+}
+
+MazeReplanner::Key MazeReplanner::calcKey(qint32 s) const
+{
+    const int m = qMin(g[s], rhs[s]);
+    return {m >= kInf ? kInf : m + heuristic(startIndex, s) + km, m};
+}
+
+// min over free neighbours of 1 + g (the edge costs of a 4-connected grid)
+int MazeReplanner::bestSuccessor(qint32 u, qint32 *next) const
+{
+    int best = kInf;
+    if (!map.isFreeAt(u)) return best;
+    for (int k = 0; k < 4; ++k) {
+        const qint32 v = u + off[k];
+        if (!map.isFreeAt(v) || g[v] >= kInf) continue; // border is never free
+        if (g[v] + 1 < best) {
+            best = g[v] + 1;
+            if (next) *next = v;
+        }
+    }
+    return best;
+}
+
+void MazeReplanner::updateVertex(qint32 u)
+{
+    if (u != goalIndex)
+        rhs[u] = bestSuccessor(u);
+    if (g[u] != rhs[u]) {
+        if (heapPos[u] >= 0) heapUpdate(u, calcKey(u));
+        else heapPush(u, calcKey(u));
+    } else if (heapPos[u] >= 0) {
+        heapRemove(u);
+    }
+}
+
+bool MazeReplanner::setBlocked(const QPoint &cell)
+{
+    if (!isValid() || !map.contains(cell) || !map.isFree(cell)) return false;
+    map.setFree(cell.x(), cell.y(), false);
+    const qint32 u = map.index(cell.x(), cell.y());
+    // every edge touching u now costs infinity
+    updateVertex(u);
+    for (int k = 0; k < 4; ++k) {
+        const qint32 v = u + off[k];
+        if (map.isFreeAt(v)) updateVertex(v);
+    }
+    return true;
+}
+
+bool MazeReplanner::setFree(const QPoint &cell)
+{
+    if (!isValid() || !map.contains(cell) || map.isFree(cell)) return false;
+    map.setFree(cell.x(), cell.y(), true);
+    const qint32 u = map.index(cell.x(), cell.y());
+    // the edges touching u cost 1 again: u gets an rhs, and may now be the
+    // better successor of its neighbours
+    updateVertex(u);
+    for (int k = 0; k < 4; ++k) {
+        const qint32 v = u + off[k];
+        if (map.isFreeAt(v)) updateVertex(v);
+    }
+    return true;
+}
+
+void MazeReplanner::moveStart(const QPoint &cell)
+{
+    if (!isValid() || !map.contains(cell)) return;
+    startIndex = map.index(cell.x(), cell.y());
+    // keys already queued stay valid lower bounds if km grows by the move
+    km += heuristic(lastStart, startIndex);
+    lastStart = startIndex;
+}
+
+bool MazeReplanner::replan(MazeSolveStats *stats)
+{
+    if (!isValid()) return false;
+    QElapsedTimer timer;
+    timer.start();
+    int expanded = 0;
+
+    while (!heap.isEmpty()
+           && (heap.first().key < calcKey(startIndex) || rhs[startIndex] != g[startIndex])) {
+        const qint32 u = heap.first().cell;
+        const Key kOld = heap.first().key;
+        const Key kNew = calcKey(u);
+        ++expanded;
+        if (kOld < kNew) {
+            heapUpdate(u, kNew);
+        } else if (g[u] > rhs[u]) {
+            g[u] = rhs[u];
+            heapRemove(u);
+            for (int k = 0; k < 4; ++k) {
+                const qint32 v = u + off[k];
+                if (map.isFreeAt(v)) updateVertex(v);
+            }
+        } else {
+            g[u] = kInf;
+            updateVertex(u);
+            for (int k = 0; k < 4; ++k) {
+                const qint32 v = u + off[k];
+                if (map.isFreeAt(v)) updateVertex(v);
+            }
+        }
+    }
+
+    if (stats) {
+        stats->nodesExpanded = expanded;
+        stats->elapsedNs = timer.nsecsElapsed();
+    }
+    return rhs[startIndex] < kInf;
+}
+
+QVector<QPoint> MazeReplanner::path() const
+{
+    QVector<QPoint> out;
+    if (!isValid() || rhs[startIndex] >= kInf) return out;
+    qint32 u = startIndex;
+    out.append(map.point(u));
+    // g falls by one per step, so this ends at the goal
+    for (int steps = rhs[startIndex]; u != goalIndex && steps > 0; --steps) {
+        qint32 next = -1;
+        if (bestSuccessor(u, &next) >= kInf || next < 0) return {};
+        u = next;
+        out.append(map.point(u));
+    }
+    return u == goalIndex ? out : QVector<QPoint>();
+}
+
+/* ======== Indexed heap ======== */
+
+void MazeReplanner::heapPush(qint32 cell, const Key &key)
+{
+    heap.append({key, cell});
+    heapPos[cell] = heap.size() - 1;
+    siftUp(heap.size() - 1);
+}
+
+void MazeReplanner::heapRemove(qint32 cell)
+{
+    const int i = heapPos[cell];
+    heapPos[cell] = -1;
+    const Node last = heap.takeLast();
+    if (i == heap.size()) return;
+    heap[i] = last;
+    heapPos[last.cell] = i;
+    siftUp(i);
+    siftDown(heapPos[last.cell]);
+}
+
+void MazeReplanner::heapUpdate(qint32 cell, const Key &key)
+{
+    const int i = heapPos[cell];
+    heap[i].key = key;
+    siftUp(i);
+    siftDown(heapPos[cell]);
+}
+
+void MazeReplanner::siftUp(int i)
+{
+    const Node n = heap[i];
+    while (i > 0) {
+        const int parent = (i - 1) / 2;
+        if (!(n.key < heap[parent].key)) break;
+        heap[i] = heap[parent];
+        heapPos[heap[i].cell] = i;
+        i = parent;
+    }
+    heap[i] = n;
+    heapPos[n.cell] = i;
+}
+
+void MazeReplanner::siftDown(int i)
+{
+    const Node n = heap[i];
+    const int size = heap.size();
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= size) break;
+        if (child + 1 < size && heap[child + 1].key < heap[child].key) ++child;
+        if (!(heap[child].key < n.key)) break;
+        heap[i] = heap[child];
+        heapPos[heap[i].cell] = i;
+        i = child;
+    }
+    heap[i] = n;
+    heapPos[n.cell] = i;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "mazegrid.h"
+#include "mazesolver.h"
+
+#include <QPoint>
+#include <QVector>
+
+// Incremental shortest path on a changing grid (D* Lite, Koenig & Likhachev).
+// The search runs backwards from the goal, so the car (the start) may move
+// and cells may become blocked or free again; replan() then only repairs the part of the
+// search the change affects instead of solving the whole grid again.
+// The grid it holds is the shared occupancy map: the photo's grid plus
+// every obstacle the car's sensors found since.
+class MazeReplanner {
+public:
+    void reset(const MazeGrid &grid, const QPoint &start, const QPoint &goal);
+    bool isValid() const { return !g.isEmpty(); }
+
+    const MazeGrid &grid() const { return map; }
+    QPoint start() const { return map.point(startIndex); }
+    QPoint goal() const  { return map.point(goalIndex); }
+
+    // Mark a newly seen obstacle. Returns false if it was already blocked
+    // or lies outside the grid.
+    bool setBlocked(const QPoint &cell);
+    // Open a cell again (the obstacle is gone). Returns false if it was
+    // already free or lies outside the grid.
+    bool setFree(const QPoint &cell);
+
+    // The car is now at cell (a free cell of the grid)
+    void moveStart(const QPoint &cell);
+
+    // Bring the search up to date; false if the goal cannot be reached
+    bool replan(MazeSolveStats *stats = nullptr);
+
+    // Cells from the start to the goal after replan(), empty if none
+    QVector<QPoint> path() const;
+
+private:
+    struct Key {
+        int k1, k2;
+        bool operator<(const Key &o) const { return k1 < o.k1 || (k1 == o.k1 && k2 < o.k2); }
+    };
+    struct Node { Key key; qint32 cell; };
+
+    int heuristic(qint32 a, qint32 b) const;
+    Key calcKey(qint32 s) const;
+    int bestSuccessor(qint32 u, qint32 *next = nullptr) const;
+    void updateVertex(qint32 u);
+
+    // indexed binary heap, so keys can be changed and cells removed
+    void heapPush(qint32 cell, const Key &key);
+    void heapRemove(qint32 cell);
+    void heapUpdate(qint32 cell, const Key &key);
+    void siftUp(int i);
+    void siftDown(int i);
+
+    MazeGrid map;
+    QVector<qint32> g, rhs;
+    QVector<qint32> heapPos;   // per cell, -1: not queued
+    QVector<Node> heap;
+    qint32 startIndex = 0, goalIndex = 0, lastStart = 0;
+    int km = 0;
+    int off[4] = {0, 0, 0, 0};
+};
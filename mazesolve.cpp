@@ -0,0 +1,205 @@
+// Batch maze solver, no GUI and no OpenAI client.
+// Solves every image on a thread pool (one image per task, so at most one
+// image per thread is in memory) and writes the moves JSON next to the
+// optional overlay.
+//
+//   mazesolve mazes/                      every image in the folder
+//   mazesolve "mazes/round*.png" a.jpg    wildcards work without a shell
+//     -o DIR          output folder (default: next to each image)
+//     -j N            worker threads (default: all cores)
+//     --overlay       also save <name>.solved.png
+//     --solver NAME   bfs, bibfs or astar (default bfs)
+//     --cells 3,2,4   cell sizes to try, in order
+//     --trace FILE    write a Chrome trace of the pipeline stages and print
+//                     their p50 / p95 / p99
+
+#include "mazepipeline.h"
+#include "perfstats.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+struct SolveOutcome {
+    QString name;
+    bool ok = false;
+    QString error;
+    int pathCells = 0;
+    int moves = 0;
+    QSize size;
+    double ms = 0;
+};
+
+static QStringList imageFilters()
+{
+    QStringList filters;
+    for (const QByteArray &fmt : QImageReader::supportedImageFormats())
+        filters << "*." + QString::fromLatin1(fmt);
+    return filters;
+}
+
+// folders, files and wildcard patterns -> image files
+static QStringList expandInputs(const QStringList &inputs)
+{
+    QStringList files;
+    for (const QString &in : inputs) {
+        const QFileInfo info(in);
+        if (info.isDir()) {
+            const QDir dir(in);
+            for (const QString &f : dir.entryList(imageFilters(), QDir::Files, QDir::Name))
+                files << dir.filePath(f);
+        } else if (in.contains('*') || in.contains('?')) {
+            const QDir dir(info.path());
+            for (const QString &f : dir.entryList({info.fileName()}, QDir::Files, QDir::Name))
+                files << dir.filePath(f);
+        } else {
+            files << in;
+        }
+    }
+    return files;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QString outDir;
+    QString tracePath;
+    bool overlay = false;
+    MazeJobOptions base;
+    base.drawOverlay = false;
+    QStringList inputs;
+
+    const QStringList args = app.arguments().mid(1);
+    for (int i = 0; i < args.size(); ++i) {
+        const QString &a = args[i];
+        const bool hasValue = i + 1 < args.size();
+        if (a == "-o" && hasValue) {
+            outDir = args[++i];
+        } else if (a == "-j" && hasValue) {
+            QThreadPool::globalInstance()->setMaxThreadCount(qMax(1, args[++i].toInt()));
+        } else if (a == "--trace" && hasValue) {
+            tracePath = args[++i];
+        } else if (a == "--overlay") {
+            overlay = true;
+        } else if (a == "--solver" && hasValue) {
+            const QString s = args[++i].toLower();
+            if (s == "bfs")        base.solver = MazeSolverKind::Bfs;
+            else if (s == "bibfs") base.solver = MazeSolverKind::BidirectionalBfs;
+            else if (s == "astar") base.solver = MazeSolverKind::AStar;
+            else { err << "Unknown solver: " << s << "\n"; return 2; }
+        } else if (a == "--cells" && hasValue) {
+            base.cellSizes.clear();
+            for (const QString &part : args[++i].split(',', Qt::SkipEmptyParts))
+                if (part.toInt() > 0) base.cellSizes.append(part.toInt());
+        } else if (a.startsWith('-')) {
+            err << "Unknown option: " << a << "\n";
+            return 2;
+        } else {
+            inputs << a;
+        }
+    }
+
+    PerfStats::setEnabled(!tracePath.isEmpty());
+    const QStringList files = expandInputs(inputs);
+    if (files.isEmpty()) {
+        err << "usage: mazesolve [-o DIR] [-j N] [--overlay] [--solver bfs|bibfs|astar] [--cells 3,2,4] "
+               "[--trace FILE] images or folders...\n";
+        return 2;
+    }
+    if (!outDir.isEmpty() && !QDir().mkpath(outDir)) {
+        err << "Could not create " << outDir << "\n";
+        return 1;
+    }
+
+    auto solveOne = [&](const QString &path) {
+        QElapsedTimer timer;
+        timer.start();
+        const QFileInfo info(path);
+        const QString stem = QDir(outDir.isEmpty() ? info.path() : outDir).filePath(info.completeBaseName());
+
+        SolveOutcome o;
+        o.name = info.fileName();
+        MazeJobOptions opt = base;
+        if (overlay) {
+            opt.drawOverlay = true;
+            opt.savePath = stem + ".solved.png";
+        }
+        const QImage img(path);
+        o.size = img.size();
+        const MazeJobResult r = runMazePipeline(img, opt);
+        o.ok = r.ok;
+        o.error = r.error;
+        if (r.ok) {
+            o.pathCells = r.gridPath.size();
+            o.moves = pathToMoveList(r.route).size();
+            QFile json(stem + ".moves.json");
+            if (json.open(QIODevice::WriteOnly | QIODevice::Truncate))
+                json.write(r.movesJson.toLatin1() + '\n');
+            else
+                o.error = "could not write " + json.fileName();
+        }
+        o.ms = timer.nsecsElapsed() / 1e6;
+        return o; // image, grid and overlay are freed here
+    };
+
+    out << QString("Solving %1 images on %2 threads\n")
+               .arg(files.size()).arg(QThreadPool::globalInstance()->maxThreadCount());
+    out.flush();
+
+    QElapsedTimer wall;
+    wall.start();
+    QFuture<SolveOutcome> jobs = QtConcurrent::mapped(files, solveOne);
+
+    int solved = 0;
+    double busyMs = 0, slowestMs = 0;
+    QString slowest;
+    QStringList failed;
+    for (int i = 0; i < files.size(); ++i) {
+        const SolveOutcome o = jobs.resultAt(i); // waits for this one, printed in input order
+        busyMs += o.ms;
+        if (o.ms > slowestMs) { slowestMs = o.ms; slowest = o.name; }
+        if (o.ok) {
+            ++solved;
+            out << QString("ok     %1  %2x%3  %4 ms  path %5 cells, %6 moves%7\n")
+                       .arg(o.name).arg(o.size.width()).arg(o.size.height()).arg(o.ms, 0, 'f', 1)
+                       .arg(o.pathCells).arg(o.moves)
+                       .arg(o.error.isEmpty() ? QString() : "  (" + o.error + ")");
+        } else {
+            failed << o.name;
+            out << QString("FAILED %1  %2 ms  %3\n").arg(o.name).arg(o.ms, 0, 'f', 1).arg(o.error);
+        }
+        out.flush();
+    }
+
+    const double wallMs = wall.nsecsElapsed() / 1e6;
+    out << QString("\n%1 solvable, %2 unsolvable of %3 images\n").arg(solved).arg(failed.size()).arg(files.size());
+    out << QString("wall %1 ms, %2 ms per image on average, slowest %3 (%4 ms), speed-up x%5\n")
+               .arg(wallMs, 0, 'f', 1).arg(busyMs / files.size(), 0, 'f', 1)
+               .arg(slowest).arg(slowestMs, 0, 'f', 1).arg(busyMs / qMax(wallMs, 1e-6), 0, 'f', 2);
+    if (!failed.isEmpty())
+        out << "unsolvable: " << failed.join(", ") << "\n";
+    if (!tracePath.isEmpty()) {
+        out << QString("\n%1 %2 %3 %4 %5 %6\n").arg("stage (ms)", -16).arg("calls", 8)
+                   .arg("p50", 10).arg("p95", 10).arg("p99", 10).arg("max", 10);
+        for (const PerfStage &s : PerfStats::snapshot()) {
+            if (s.counter || !s.name.startsWith("maze.")) continue;
+            out << QString("%1 %2 %3 %4 %5 %6\n").arg(QString::fromLatin1(s.name), -16).arg(s.count, 8)
+                       .arg(s.p50Ns / 1e6, 10, 'f', 2).arg(s.p95Ns / 1e6, 10, 'f', 2)
+                       .arg(s.p99Ns / 1e6, 10, 'f', 2).arg(s.maxNs / 1e6, 10, 'f', 2);
+        }
+        if (PerfStats::writeChromeTrace(tracePath))
+            out << "trace written to " << tracePath << "\n";
+        else
+            err << "Could not write " << tracePath << "\n";
+    }
+    return failed.isEmpty() ? 0 : 1;
+}
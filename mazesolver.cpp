@@ -0,0 +1,320 @@
+#include "mazesolver.h"
+
+#include <QElapsedTimer>
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+QString mazeSolverName(MazeSolverKind kind)
+{
+    switch (kind) {
+    case MazeSolverKind::Bfs:              return "BFS";
+    case MazeSolverKind::BidirectionalBfs: return "Bidirectional BFS";
+    case MazeSolverKind::AStar:            return "A*";
+    }
+    return "?";
+}
+
+QString MazeSolver::name() const
+{
+    return mazeSolverName(kind());
+}
+
+QVector<QPoint> MazeSolver::solve(const MazeGrid &grid, const QPoint &start, const QPoint &goal,
+                                  MazeSolveStats *stats)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    int expanded = 0;
+    QVector<QPoint> path;
+    if (!grid.isEmpty() && grid.contains(start) && grid.contains(goal)) {
+        const QVector<qint32> ids = search(grid, grid.index(start.x(), start.y()),
+                                           grid.index(goal.x(), goal.y()), expanded);
+        path.reserve(ids.size());
+        for (qint32 i : ids)
+            path.append(grid.point(i));
+    }
+
+    if (stats) {
+        stats->nodesExpanded = expanded;
+        stats->elapsedNs = timer.nsecsElapsed();
+    }
+    return path;
+}
+
+// Follow parent links from v back to the root (parent[root] == root)
+static void appendChain(const QVector<qint32> &parent, qint32 v, QVector<qint32> &out)
+{
+    for (;; v = parent[v]) {
+        out.append(v);
+        if (parent[v] == v) break;
+    }
+}
+
+/* ======== BFS ======== */
+
+namespace {
+
+class BfsSolver : public MazeSolver {
+public:
+    MazeSolverKind kind() const override { return MazeSolverKind::Bfs; }
+
+protected:
+    QVector<qint32> search(const MazeGrid &grid, qint32 s, qint32 g, int &expanded) override
+    {
+        const uchar *cells = grid.data();
+        const int off[4] = {grid.offset(0), grid.offset(1), grid.offset(2), grid.offset(3)};
+
+        parent.fill(-1, grid.cellCount());
+        queue.reserve(grid.cellCount());
+
+        parent[s] = s;
+        queue.push(s);
+        while (!queue.isEmpty()) {
+            const qint32 u = queue.pop();
+            ++expanded;
+            if (u == g) break;
+            for (int k = 0; k < 4; ++k) {
+                const qint32 v = u + off[k];
+                if (!cells[v] || parent[v] != -1) continue;
+                parent[v] = u;
+                queue.push(v);
+            }
+        }
+
+        QVector<qint32> path;
+        if (parent[g] == -1) return path;
+        appendChain(parent, g, path);
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+private:
+    QVector<qint32> parent;
+    IndexRing queue;
+};
+
+/* ======== Bidirectional BFS ======== */
+
+// Grows one BFS from the start and one from the goal, always expanding a
+// whole layer of the smaller frontier. When the frontiers touch, the rest
+// of that layer is still scanned so the shortest meeting point wins.
+class BidirectionalBfsSolver : public MazeSolver {
+public:
+    MazeSolverKind kind() const override { return MazeSolverKind::BidirectionalBfs; }
+
+protected:
+    QVector<qint32> search(const MazeGrid &grid, qint32 s, qint32 g, int &expanded) override
+    {
+        QVector<qint32> path;
+        if (s == g) { path.append(s); return path; }
+
+        const int n = grid.cellCount();
+        parentF.fill(-1, n); parentB.fill(-1, n);
+        distF.fill(-1, n);   distB.fill(-1, n);
+        queueF.reserve(n);   queueB.reserve(n);
+
+        parentF[s] = s; distF[s] = 0; queueF.push(s);
+        parentB[g] = g; distB[g] = 0; queueB.push(g);
+
+        qint32 meetA = -1, meetB = -1; // meetA seen from start, meetB from goal
+        int best = INT_MAX;
+
+        while (!queueF.isEmpty() && !queueB.isEmpty() && meetA < 0) {
+            const bool forward = queueF.size() <= queueB.size();
+            IndexRing &q            = forward ? queueF  : queueB;
+            QVector<qint32> &par    = forward ? parentF : parentB;
+            QVector<qint32> &dist   = forward ? distF   : distB;
+            const QVector<qint32> &otherDist = forward ? distB : distF;
+
+            for (int layer = q.size(); layer > 0; --layer) {
+                const qint32 u = q.pop();
+                ++expanded;
+                expandCell(grid, u, par, dist, otherDist, q, forward, best, meetA, meetB);
+            }
+        }
+
+        if (meetA < 0) return path;
+
+        // start ... meetA, then the adjacent meetB ... goal
+        appendChain(parentF, meetA, path);
+        std::reverse(path.begin(), path.end());
+        appendChain(parentB, meetB, path);
+        return path;
+    }
+
+private:
+    void expandCell(const MazeGrid &grid, qint32 u, QVector<qint32> &par, QVector<qint32> &dist,
+                    const QVector<qint32> &otherDist, IndexRing &q, bool forward,
+                    int &best, qint32 &meetA, qint32 &meetB)
+    {
+        const uchar *cells = grid.data();
+        for (int k = 0; k < 4; ++k) {
+            const qint32 v = u + grid.offset(k);
+            if (!cells[v]) continue;
+            if (otherDist[v] != -1) {
+                const int len = dist[u] + 1 + otherDist[v];
+                if (len < best) {
+                    best = len;
+                    meetA = forward ? u : v;
+                    meetB = forward ? v : u;
+                }
+            }
+            if (dist[v] != -1) continue;
+            dist[v] = dist[u] + 1;
+            par[v] = u;
+            q.push(v);
+        }
+    }
+
+    QVector<qint32> parentF, parentB, distF, distB;
+    IndexRing queueF, queueB;
+};
+
+/* ======== A* ======== */
+
+// A* with the Manhattan distance, which is exact on open corridors and
+// never overestimates on a 4-connected unit-cost grid. Ties on f prefer the
+// node closer to the goal, which keeps the search narrow in open areas.
+class AStarSolver : public MazeSolver {
+public:
+    MazeSolverKind kind() const override { return MazeSolverKind::AStar; }
+
+protected:
+    struct Node {
+        qint32 f, h, idx;
+        bool operator<(const Node &o) const { // std heap is a max-heap
+            return f != o.f ? f > o.f : h > o.h;
+        }
+    };
+
+    QVector<qint32> search(const MazeGrid &grid, qint32 s, qint32 g, int &expanded) override
+    {
+        const int n = grid.cellCount();
+        const uchar *cells = grid.data();
+        const QPoint goal = grid.point(g);
+        auto heuristic = [&](qint32 i) {
+            const QPoint p = grid.point(i);
+            return qint32(qAbs(p.x() - goal.x()) + qAbs(p.y() - goal.y()));
+        };
+
+        parent.fill(-1, n);
+        cost.fill(INT_MAX, n);
+        closed.fill(0, n);
+        heap.clear();
+        heap.reserve(1024);
+
+        parent[s] = s;
+        cost[s] = 0;
+        heap.push_back({heuristic(s), heuristic(s), s});
+
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end());
+            const Node cur = heap.back();
+            heap.pop_back();
+            const qint32 u = cur.idx;
+            if (closed[u]) continue; // stale entry
+            closed[u] = 1;
+            ++expanded;
+            if (u == g) break;
+
+            for (int k = 0; k < 4; ++k) {
+                const qint32 v = u + grid.offset(k);
+                if (!cells[v] || closed[v]) continue;
+                const qint32 c = cost[u] + 1;
+                if (c >= cost[v]) continue;
+                cost[v] = c;
+                parent[v] = u;
+                const qint32 h = heuristic(v);
+                heap.push_back({c + h, h, v});
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+
+        QVector<qint32> path;
+        if (parent[g] == -1) return path;
+        appendChain(parent, g, path);
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+private:
+    QVector<qint32> parent, cost;
+    QVector<uchar> closed;
+    std::vector<Node> heap;
+};
+
+} // namespace
+
+/* ======== Distance field ======== */
+
+DistanceField::DistanceField(const MazeGrid &grid, const QPoint &goal)
+{
+    if (grid.isEmpty() || !grid.contains(goal) || !grid.isFree(goal)) return;
+    w = grid.width();
+    h = grid.height();
+    stride = grid.stride();
+    target = goal;
+
+    const uchar *cells = grid.data();
+    const int off[4] = {grid.offset(0), grid.offset(1), grid.offset(2), grid.offset(3)};
+    dist.fill(-1, grid.cellCount());
+    IndexRing queue;
+    queue.reserve(grid.cellCount());
+
+    const qint32 g = grid.index(goal.x(), goal.y());
+    dist[g] = 0;
+    queue.push(g);
+    while (!queue.isEmpty()) {
+        const qint32 u = queue.pop();
+        for (int k = 0; k < 4; ++k) {
+            const qint32 v = u + off[k];
+            if (!cells[v] || dist[v] != -1) continue; // border is never free
+            dist[v] = dist[u] + 1;
+            queue.push(v);
+        }
+    }
+}
+
+int DistanceField::distance(const QPoint &p) const
+{
+    if (!isValid() || p.x() < 0 || p.y() < 0 || p.x() >= w || p.y() >= h) return -1;
+    return dist[(p.y() + 1) * stride + p.x() + 1];
+}
+
+QPoint DistanceField::nextStep(const QPoint &p) const
+{
+    const int d = distance(p);
+    if (d <= 0) return p;
+    const QPoint steps[4] = {QPoint(1, 0), QPoint(-1, 0), QPoint(0, 1), QPoint(0, -1)};
+    for (const QPoint &s : steps) {
+        if (distance(p + s) == d - 1) return p + s;
+    }
+    return p; // not reached: a cell at distance d has a neighbour at d-1
+}
+
+QVector<QPoint> DistanceField::pathFrom(const QPoint &p) const
+{
+    QVector<QPoint> path;
+    int d = distance(p);
+    if (d < 0) return path;
+    path.reserve(d + 1);
+    QPoint c = p;
+    path.append(c);
+    for (; d > 0; --d) {
+        c = nextStep(c);
+        path.append(c);
+    }
+    return path;
+}
+
+std::unique_ptr<MazeSolver> makeMazeSolver(MazeSolverKind kind)
+{
+    switch (kind) {
+    case MazeSolverKind::Bfs:              return std::make_unique<BfsSolver>();
+    case MazeSolverKind::BidirectionalBfs: return std::make_unique<BidirectionalBfsSolver>();
+    case MazeSolverKind::AStar:            return std::make_unique<AStarSolver>();
+    }
+    return std::make_unique<BfsSolver>();
+}
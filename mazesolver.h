@@ -0,0 +1,89 @@
+#pragma once
+#include "mazegrid.h"
+
+#include <QPoint>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+// Fixed-capacity FIFO of cell indices. Capacity is rounded up to a power of
+// two and allocated once, so pushing and popping never touch the heap.
+class IndexRing {
+public:
+    void reserve(int n) {
+        int cap = 1;
+        while (cap < n) cap <<= 1;
+        if (cap > buf.size()) buf.resize(cap);
+        mask = buf.size() - 1;
+        clear();
+    }
+    void clear()          { head = tail = 0; }
+    bool isEmpty() const  { return head == tail; }
+    int size() const      { return int(tail - head); }
+    void push(qint32 v)   { buf[int(tail++ & mask)] = v; }
+    qint32 pop()          { return buf[int(head++ & mask)]; }
+
+private:
+    QVector<qint32> buf;
+    quint32 mask = 0;
+    quint32 head = 0;
+    quint32 tail = 0;
+};
+
+enum class MazeSolverKind { Bfs, BidirectionalBfs, AStar };
+
+struct MazeSolveStats {
+    int nodesExpanded = 0;  // cells taken off the frontier and expanded
+    qint64 elapsedNs = 0;   // wall time of solve()
+};
+
+// Shortest-path solver on a MazeGrid (4-connected, unit cost).
+// Solvers keep their scratch buffers between calls, so reuse one instance
+// when solving many grids of similar size.
+class MazeSolver {
+public:
+    virtual ~MazeSolver() = default;
+    virtual MazeSolverKind kind() const = 0;
+    QString name() const;
+
+    // Path of grid cells from start to goal (inclusive), empty if none
+    QVector<QPoint> solve(const MazeGrid &grid, const QPoint &start, const QPoint &goal,
+                          MazeSolveStats *stats = nullptr);
+
+protected:
+    // Padded-grid indices of the path from s to g, empty if unreachable
+    virtual QVector<qint32> search(const MazeGrid &grid, qint32 s, qint32 g, int &expanded) = 0;
+};
+
+QString mazeSolverName(MazeSolverKind kind);
+std::unique_ptr<MazeSolver> makeMazeSolver(MazeSolverKind kind);
+
+// Distance to the goal from every free cell, from one reverse BFS.
+// Built once per grid; afterwards the next step from any cell is a lookup
+// (the neighbour one cell closer), so a car that was moved or re-localized
+// gets a new route without another search.
+class DistanceField {
+public:
+    DistanceField() = default;
+    DistanceField(const MazeGrid &grid, const QPoint &goal);
+
+    bool isValid() const { return !dist.isEmpty(); }
+    QPoint goal() const  { return target; }
+
+    // Cells to the goal, -1 if blocked, outside the grid or unreachable
+    int distance(const QPoint &p) const;
+
+    // Neighbour one cell closer to the goal; p itself at the goal or when
+    // there is no way to it
+    QPoint nextStep(const QPoint &p) const;
+
+    // Cells from p to the goal (inclusive), empty if unreachable
+    QVector<QPoint> pathFrom(const QPoint &p) const;
+
+private:
+    int w = 0;
+    int h = 0;
+    int stride = 0;
+    QPoint target;
+    QVector<qint32> dist;   // padded-grid layout, -1: not reachable
+};
@@ -0,0 +1,119 @@
+#include "perfpanel.h"
+#include "perfstats.h"
+
+#include <QCheckBox>
+#include <QDateTime>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+static QString formatNs(qint64 ns)
+{
+    if (ns < 10000) return QString("%1 us").arg(ns / 1e3, 0, 'f', 2);
+    if (ns < 10000000) return QString("%1 ms").arg(ns / 1e6, 0, 'f', 2);
+    return QString("%1 ms").arg(ns / 1e6, 0, 'f', 0);
+}
+
+PerfPanel::PerfPanel(QWidget *parent)
+    : QMainWindow(parent),
+    table(new QTableWidget(this)),
+    enabledBox(new QCheckBox("Record", this)),
+    status(new QLabel(this))
+{
+    setWindowTitle("Performance");
+    resize(760, 480);
+
+    auto *central = new QWidget(this);
+    auto *layout = new QVBoxLayout(central);
+    setCentralWidget(central);
+
+    // Stage | Calls | Rate | p50 | p95 | p99 | Max | Mean
+    const QStringList headers {"Stage", "Calls", "Per second", "p50", "p95", "p99", "Max", "Mean"};
+    table->setColumnCount(headers.size());
+    table->setHorizontalHeaderLabels(headers);
+    table->verticalHeader()->hide();
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionMode(QAbstractItemView::NoSelection);
+    table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    layout->addWidget(table, 1);
+
+    auto *row = new QHBoxLayout();
+    auto *resetBtn = new QPushButton("Reset", this);
+    auto *exportBtn = new QPushButton("Export trace...", this);
+    enabledBox->setChecked(PerfStats::isEnabled());
+    enabledBox->setToolTip("Time the hot paths (maze stages, encoding, requests, camera, sensors)");
+    row->addWidget(enabledBox);
+    row->addWidget(status, 1);
+    row->addWidget(resetBtn);
+    row->addWidget(exportBtn);
+    layout->addLayout(row);
+
+    connect(enabledBox, &QCheckBox::toggled, this, [](bool on) { PerfStats::setEnabled(on); });
+    connect(resetBtn, &QPushButton::clicked, this, &PerfPanel::reset);
+    connect(exportBtn, &QPushButton::clicked, this, &PerfPanel::exportTrace);
+    connect(&refreshTimer, &QTimer::timeout, this, &PerfPanel::refresh);
+}
+
+void PerfPanel::showEvent(QShowEvent *event) {
+    QMainWindow::showEvent(event);
+    enabledBox->setChecked(PerfStats::isEnabled());
+    refresh();
+    refreshTimer.start(500);
+}
+
+void PerfPanel::hideEvent(QHideEvent *event) {
+    refreshTimer.stop();
+    QMainWindow::hideEvent(event);
+}
+
+void PerfPanel::refresh() {
+    const QVector<PerfStage> stages = PerfStats::snapshot();
+    const double seconds = sinceRefresh.isValid() ? sinceRefresh.restart() / 1000.0 : 0.0;
+    if (!sinceRefresh.isValid()) sinceRefresh.start();
+
+    table->setRowCount(stages.size());
+    for (int i = 0; i < stages.size(); ++i) {
+        const PerfStage &s = stages[i];
+        const quint64 before = lastCounts.value(s.name, s.count);
+        lastCounts.insert(s.name, s.count);
+        const double rate = seconds > 0 && s.count >= before ? (s.count - before) / seconds : 0.0;
+
+        QStringList cells {QString::fromLatin1(s.name), QString::number(s.count), QString::number(rate, 'f', 1)};
+        if (s.counter) {
+            cells << QString() << QString() << QString() << QString() << QString();
+        } else {
+            cells << formatNs(s.p50Ns) << formatNs(s.p95Ns) << formatNs(s.p99Ns) << formatNs(s.maxNs)
+                  << formatNs(s.count ? s.totalNs / qint64(s.count) : 0);
+        }
+        for (int c = 0; c < cells.size(); ++c) {
+            QTableWidgetItem *item = table->item(i, c);
+            if (!item) {
+                item = new QTableWidgetItem;
+                if (c > 0) item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                table->setItem(i, c, item);
+            }
+            item->setText(cells[c]);
+        }
+    }
+    status->setText(stages.isEmpty() ? QString("Nothing recorded yet.")
+                                     : QString("%1 stages and counters").arg(stages.size()));
+}
+
+void PerfPanel::reset() {
+    PerfStats::reset();
+    lastCounts.clear();
+    refresh();
+}
+
+void PerfPanel::exportTrace() {
+    const QString suggested = QString("trace_%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
+    const QString path = QFileDialog::getSaveFileName(this, "Export Chrome trace", suggested, "Trace (*.json)");
+    if (path.isEmpty()) return;
+    status->setText(PerfStats::writeChromeTrace(path)
+                        ? "Trace written to " + path + " (open in ui.perfetto.dev or chrome://tracing)"
+                        : "Could not write " + path);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMainWindow>
+#include <QTimer>
+
+class QCheckBox;
+class QLabel;
+class QTableWidget;
+
+// Live table of PerfStats: calls, rate, p50 / p95 / p99 / max latency per
+// stage, plus the counters. Export writes a Chrome trace of the recent spans.
+class PerfPanel : public QMainWindow {
+    Q_OBJECT
+public:
+    explicit PerfPanel(QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    void refresh();
+    void exportTrace();
+    void reset();
+
+    QTableWidget *table;
+    QCheckBox *enabledBox;
+    QLabel *status;
+    QTimer refreshTimer;            // only runs while the panel is visible
+    QElapsedTimer sinceRefresh;
+    QHash<QByteArray, quint64> lastCounts; // for the per-second rates
+};
@@ -0,0 +1,307 @@
+#include "perfstats.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+#include <QThread>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// 8 linear sub-buckets per power of two: bucket b < 8 holds the value b,
+// above that (8 + sub) << (msb - 3) up to the next sub-bucket
+const int kBuckets = 61 * 8;
+const int kTraceEvents = 4096;   // spans kept per thread
+
+int bucketOf(qint64 ns)
+{
+    if (ns < 8) return int(qMax<qint64>(ns, 0));
+    const int msb = 63 - qCountLeadingZeroBits(quint64(ns));
+    return (msb - 2) * 8 + int((ns >> (msb - 3)) & 7);
+}
+
+qint64 bucketMiddle(int b)
+{
+    if (b < 8) return b;
+    const int shift = b / 8 - 1;            // msb - 3
+    const qint64 low = qint64(8 + b % 8) << shift;
+    return low + ((qint64(1) << shift) >> 1);
+}
+
+struct StageData {
+    const char *name = nullptr;
+    bool counter = false;
+    quint64 count = 0;
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+    quint32 buckets[kBuckets] = {};
+};
+
+struct TraceEvent {
+    const char *name;
+    qint64 startNs;
+    qint64 durNs;
+    quint32 tid;
+};
+
+// One per thread; only its own thread writes, the lock is there for the
+// (rare) readers, so it is practically never contended
+struct ThreadLog {
+    QMutex lock;
+    quint32 tid = 0;
+    bool alive = true;
+    QVector<StageData *> stages;
+    QVector<TraceEvent> ring;
+    int next = 0;
+    bool wrapped = false;
+
+    StageData *stage(const char *name, bool counter) {
+        for (StageData *s : stages)
+            if (s->name == name) return s;
+        auto *s = new StageData;
+        s->name = name;
+        s->counter = counter;
+        stages.append(s);
+        return s;
+    }
+    void clear() {
+        qDeleteAll(stages);
+        stages.clear();
+        next = 0;
+        wrapped = false;
+    }
+};
+
+struct Registry {
+    QMutex lock;
+    QVector<ThreadLog *> logs;      // logs of finished threads are reused
+    QMap<quint32, QByteArray> threadNames;
+    quint32 nextTid = 1;
+    QElapsedTimer clock;
+    std::atomic<bool> enabled {qEnvironmentVariable("SMARTSYSTEMS_PERF") != "0"};
+
+    Registry() { clock.start(); }
+};
+
+Registry &registry()
+{
+    static Registry *r = new Registry; // never destroyed: threads may record during exit
+    return *r;
+}
+
+QByteArray currentThreadName()
+{
+    QThread *t = QThread::currentThread();
+    if (QCoreApplication::instance() && t == QCoreApplication::instance()->thread())
+        return "main";
+    const QString name = t ? t->objectName() : QString();
+    return name.isEmpty() ? QByteArray("worker") : name.toUtf8();
+}
+
+// Hands the log back to the registry when the thread ends
+struct ThreadLogHolder {
+    ThreadLog *log = nullptr;
+    ~ThreadLogHolder() {
+        if (!log) return;
+        QMutexLocker lock(&registry().lock);
+        log->alive = false;
+    }
+};
+
+ThreadLog *threadLog()
+{
+    thread_local ThreadLogHolder holder;
+    if (holder.log) return holder.log;
+
+    Registry &r = registry();
+    QMutexLocker lock(&r.lock);
+    for (ThreadLog *log : r.logs) {
+        if (!log->alive) { holder.log = log; break; }
+    }
+    if (!holder.log) {
+        holder.log = new ThreadLog;
+        holder.log->ring.resize(kTraceEvents);
+        r.logs.append(holder.log);
+    }
+    QMutexLocker logLock(&holder.log->lock);
+    holder.log->alive = true;
+    holder.log->tid = r.nextTid++;
+    r.threadNames.insert(holder.log->tid, currentThreadName());
+    return holder.log;
+}
+
+qint64 percentile(const quint32 *buckets, quint64 count, qint64 maxNs, double q)
+{
+    const quint64 rank = quint64(q * (count - 1));
+    quint64 seen = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+        seen += buckets[b];
+        if (seen > rank) return qMin(bucketMiddle(b), maxNs);
+    }
+    return maxNs;
+}
+
+void appendJsonString(QByteArray &out, const QByteArray &s)
+{
+    out += '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (uchar(c) >= 0x20) out += c;
+    }
+    out += '"';
+}
+
+} // namespace
+
+qint64 PerfStats::nowNs()
+{
+    return registry().clock.nsecsElapsed();
+}
+
+void PerfStats::setEnabled(bool on)
+{
+    registry().enabled.store(on, std::memory_order_relaxed);
+}
+
+bool PerfStats::isEnabled()
+{
+    return registry().enabled.load(std::memory_order_relaxed);
+}
+
+void PerfStats::record(const char *name, qint64 startNs, qint64 endNs)
+{
+    if (!isEnabled()) return;
+    ThreadLog *log = threadLog();
+    const qint64 ns = qMax<qint64>(endNs - startNs, 0);
+
+    QMutexLocker lock(&log->lock);
+    StageData *s = log->stage(name, false);
+    ++s->count;
+    s->totalNs += ns;
+    s->maxNs = qMax(s->maxNs, ns);
+    ++s->buckets[bucketOf(ns)];
+
+    log->ring[log->next] = {name, startNs, ns, log->tid};
+    if (++log->next == kTraceEvents) {
+        log->next = 0;
+        log->wrapped = true;
+    }
+}
+
+void PerfStats::count(const char *name, qint64 n)
+{
+    if (!isEnabled() || n <= 0) return;
+    ThreadLog *log = threadLog();
+    QMutexLocker lock(&log->lock);
+    log->stage(name, true)->count += quint64(n);
+}
+
+QVector<PerfStage> PerfStats::snapshot()
+{
+    // merge by name: the same stage is recorded on many threads
+    struct Merged { PerfStage stage; QVector<quint32> buckets; };
+    QMap<QByteArray, Merged> merged;
+
+    Registry &r = registry();
+    QMutexLocker lock(&r.lock);
+    for (ThreadLog *log : r.logs) {
+        QMutexLocker logLock(&log->lock);
+        for (const StageData *s : log->stages) {
+            Merged &m = merged[QByteArray(s->name)];
+            if (m.buckets.isEmpty()) {
+                m.stage.name = s->name;
+                m.stage.counter = s->counter;
+                m.buckets.fill(0, kBuckets);
+            }
+            m.stage.count += s->count;
+            m.stage.totalNs += s->totalNs;
+            m.stage.maxNs = qMax(m.stage.maxNs, s->maxNs);
+            for (int b = 0; b < kBuckets; ++b)
+                m.buckets[b] += s->buckets[b];
+        }
+    }
+    lock.unlock();
+
+    QVector<PerfStage> out;
+    out.reserve(merged.size());
+    for (Merged &m : merged) {
+        if (!m.stage.counter && m.stage.count > 0) {
+            const quint32 *b = m.buckets.constData();
+            m.stage.p50Ns = percentile(b, m.stage.count, m.stage.maxNs, 0.50);
+            m.stage.p95Ns = percentile(b, m.stage.count, m.stage.maxNs, 0.95);
+            m.stage.p99Ns = percentile(b, m.stage.count, m.stage.maxNs, 0.99);
+        }
+        out.append(m.stage);
+    }
+    return out;
+}
+
+void PerfStats::reset()
+{
+    Registry &r = registry();
+    QMutexLocker lock(&r.lock);
+    for (ThreadLog *log : r.logs) {
+        QMutexLocker logLock(&log->lock);
+        log->clear();
+    }
+}
+
+QByteArray PerfStats::chromeTrace()
+{
+    QVector<TraceEvent> events;
+    QMap<quint32, QByteArray> names;
+    {
+        Registry &r = registry();
+        QMutexLocker lock(&r.lock);
+        names = r.threadNames;
+        for (ThreadLog *log : r.logs) {
+            QMutexLocker logLock(&log->lock);
+            const int n = log->wrapped ? kTraceEvents : log->next;
+            const int first = log->wrapped ? log->next : 0;
+            for (int i = 0; i < n; ++i)
+                events.append(log->ring[(first + i) % kTraceEvents]);
+        }
+    }
+    std::sort(events.begin(), events.end(),
+              [](const TraceEvent &a, const TraceEvent &b) { return a.startNs < b.startNs; });
+
+    // complete events ("X") in microseconds, plus one name record per thread
+    QByteArray out;
+    out.reserve(128 + events.size() * 96);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (auto it = names.constBegin(); it != names.constEnd(); ++it) {
+        if (!first) out += ',';
+        first = false;
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + QByteArray::number(it.key())
+               + ",\"args\":{\"name\":";
+        appendJsonString(out, it.value());
+        out += "}}";
+    }
+    for (const TraceEvent &e : events) {
+        if (!first) out += ',';
+        first = false;
+        const QByteArray name(e.name);
+        const int dot = name.indexOf('.');
+        out += "{\"name\":";
+        appendJsonString(out, name);
+        out += ",\"cat\":";
+        appendJsonString(out, dot > 0 ? name.left(dot) : name);
+        out += ",\"ph\":\"X\",\"ts\":" + QByteArray::number(e.startNs / 1000.0, 'f', 3)
+               + ",\"dur\":" + QByteArray::number(e.durNs / 1000.0, 'f', 3)
+               + ",\"pid\":1,\"tid\":" + QByteArray::number(e.tid) + '}';
+    }
+    out += "]}\n";
+    return out;
+}
+
+bool PerfStats::writeChromeTrace(const QString &path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    return f.write(chromeTrace()) >= 0;
+}
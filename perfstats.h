@@ -0,0 +1,67 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// Latency of one stage (or the count of one counter) over every thread
+struct PerfStage {
+    QByteArray name;
+    bool counter = false;        // count() only, no durations
+    quint64 count = 0;
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+    qint64 p50Ns = 0, p95Ns = 0, p99Ns = 0;
+};
+
+// Low-overhead timing for the hot paths (maze stages, encoding, requests,
+// camera frames, sensor parsing). Every thread records into its own buffer:
+// a log-linear histogram per stage (12.5% resolution) and a ring of its last
+// spans for the trace. Only snapshot() and chromeTrace() visit all threads.
+// Names are kept as pointers, so they must be string literals; the part
+// before the first '.' is the trace category ("maze.solve" -> "maze").
+class PerfStats {
+public:
+    static qint64 nowNs();       // monotonic clock shared by every thread
+
+    // One span; for work that starts and ends in different callbacks
+    static void record(const char *name, qint64 startNs, qint64 endNs);
+    // Events without a duration (frames, samples, parse errors)
+    static void count(const char *name, qint64 n = 1);
+
+    static QVector<PerfStage> snapshot(); // sorted by name
+    static void reset();
+
+    // Retained spans as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)
+    static QByteArray chromeTrace();
+    static bool writeChromeTrace(const QString &path);
+
+    // On unless SMARTSYSTEMS_PERF=0; when off a scope costs one atomic load
+    static void setEnabled(bool on);
+    static bool isEnabled();
+};
+
+// Times its own lifetime. next() closes the current stage and starts the
+// following one, so sequential stages need no extra blocks.
+class PerfScope {
+public:
+    explicit PerfScope(const char *name)
+        : stage(name), start(PerfStats::isEnabled() ? PerfStats::nowNs() : -1) {}
+    ~PerfScope() { stop(); }
+
+    void next(const char *name) {
+        const qint64 now = start >= 0 ? PerfStats::nowNs() : -1;
+        if (start >= 0) PerfStats::record(stage, start, now);
+        stage = name;
+        start = now;
+    }
+    void stop() {
+        if (start >= 0) PerfStats::record(stage, start, PerfStats::nowNs());
+        start = -1;
+    }
+
+private:
+    Q_DISABLE_COPY(PerfScope)
+    const char *stage;
+    qint64 start;
+};
@@ -0,0 +1,70 @@
+#include "responsecache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+ResponseCache::ResponseCache(const QString &dir, int maxMemoryBytes, int maxDiskEntries)
+    : memory(maxMemoryBytes), dir(dir)
+{
+    if (this->dir.isEmpty()) return;
+    if (!QDir().mkpath(this->dir)) { this->dir.clear(); return; }
+    pruneDisk(maxDiskEntries);
+}
+
+QByteArray ResponseCache::key(const QString &model, const QJsonArray &messages)
+{
+    QCryptographicHash h(QCryptographicHash::Sha256);
+    h.addData(model.toUtf8());
+    h.addData(QByteArrayView("\0", 1));
+    h.addData(QJsonDocument(messages).toJson(QJsonDocument::Compact));
+    return h.result().toHex();
+}
+
+bool ResponseCache::lookup(const QByteArray &key, QString &reply)
+{
+    if (const QString *hit = memory.object(key)) {
+        reply = *hit;
+        ++hitCount;
+        return true;
+    }
+    if (!dir.isEmpty()) {
+        QFile f(filePath(key));
+        if (f.open(QIODevice::ReadOnly)) {
+            reply = QString::fromUtf8(f.readAll());
+            memory.insert(key, new QString(reply), qMax<qsizetype>(1, reply.size() * 2));
+            ++hitCount;
+            return true;
+        }
+    }
+    ++missCount;
+    return false;
+}
+
+void ResponseCache::insert(const QByteArray &key, const QString &reply)
+{
+    if (reply.isEmpty()) return;
+    memory.insert(key, new QString(reply), qMax<qsizetype>(1, reply.size() * 2));
+
+    if (dir.isEmpty()) return;
+    QSaveFile f(filePath(key));
+    if (f.open(QIODevice::WriteOnly)) {
+        f.write(reply.toUtf8());
+        f.commit();
+    }
+}
+
+QString ResponseCache::filePath(const QByteArray &key) const
+{
+    return dir + '/' + QString::fromLatin1(key) + ".txt";
+}
+
+void ResponseCache::pruneDisk(int maxEntries)
+{
+    const QFileInfoList files = QDir(dir).entryInfoList({"*.txt"}, QDir::Files, QDir::Time); // newest first
+    for (int i = maxEntries; i < files.size(); ++i)
+        QFile::remove(files[i].absoluteFilePath());
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <QByteArray>
+#include <QCache>
+#include <QJsonArray>
+#include <QString>
+
+// Content-addressed cache of assistant replies.
+// The key is a SHA-256 of the model and the request messages (image data
+// URLs included), so identical requests are answered without a round trip.
+// Memory tier: LRU bounded by reply size. Disk tier (optional): one file
+// per key in dir, oldest files pruned at startup.
+class ResponseCache {
+public:
+    explicit ResponseCache(const QString &dir = QString(), int maxMemoryBytes = 4 << 20,
+                           int maxDiskEntries = 500);
+
+    static QByteArray key(const QString &model, const QJsonArray &messages);
+
+    bool lookup(const QByteArray &key, QString &reply);
+    void insert(const QByteArray &key, const QString &reply);
+
+    bool hasDiskTier() const { return !dir.isEmpty(); }
+    int hits() const { return hitCount; }
+    int misses() const { return missCount; }
+
+private:
+    QString filePath(const QByteArray &key) const;
+    void pruneDisk(int maxEntries);
+
+    QCache<QByteArray, QString> memory; // cost = bytes of the reply
+    QString dir;
+    int hitCount = 0;
+    int missCount = 0;
+};
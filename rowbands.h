@@ -0,0 +1,34 @@
+#pragma once
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+#include <numeric>
+
+// Row-band parallelism for full-image scans.
+// rowBandCount() picks how many horizontal bands a scan of rows x
+// pixelsPerRow should be cut into: one (run serially) for small images,
+// otherwise a few per core. forEachRowBand() runs fn(band, y0, y1) for every
+// band on the global thread pool and returns when all are done. Bands never
+// overlap, so writes to their own rows need no locking, and per-band results
+// can be merged in band order to get exactly the serial answer.
+inline int rowBandCount(int rows, qint64 pixelsPerRow)
+{
+    const qint64 kMinBandPixels = 1 << 18;          // below this, threads cost more than they save
+    const int maxBands = qMin(rows, QThread::idealThreadCount() * 4);
+    return int(qBound<qint64>(1, qint64(rows) * pixelsPerRow / kMinBandPixels, qMax(1, maxBands)));
+}
+
+template <typename F>
+void forEachRowBand(int bands, int rows, F &&fn)
+{
+    auto run = [&](int b) {
+        fn(b, int(qint64(b) * rows / bands), int(qint64(b + 1) * rows / bands));
+    };
+    if (bands <= 1) {
+        run(0);
+        return;
+    }
+    QVector<int> index(bands);
+    std::iota(index.begin(), index.end(), 0);
+    QtConcurrent::blockingMap(index, [&](int &b) { run(b); });
+}
@@ -0,0 +1,149 @@
+#include "scenegate.h"
+
+static const int kThumbW = 32, kThumbH = 24;
+static const int kSamples = 4;   // per cell and direction
+
+// Average brightness of cols x rows cells, from kSamples^2 pixels per cell;
+// luma(x, y) gives 0..255
+template <typename Luma>
+static void cellMeans(int w, int h, int cols, int rows, const Luma &luma, uchar *out)
+{
+    for (int cy = 0; cy < rows; ++cy) {
+        for (int cx = 0; cx < cols; ++cx) {
+            int sum = 0;
+            for (int sy = 0; sy < kSamples; ++sy) {
+                const int y = int((cy + (sy + 0.5) / kSamples) * h / rows);
+                for (int sx = 0; sx < kSamples; ++sx)
+                    sum += luma(int((cx + (sx + 0.5) / kSamples) * w / cols), y);
+            }
+            out[cy * cols + cx] = uchar(sum / (kSamples * kSamples));
+        }
+    }
+}
+
+template <typename Luma>
+static SceneSignature signatureOf(int w, int h, const Luma &luma)
+{
+    SceneSignature sig;
+    sig.thumb.resize(kThumbW * kThumbH);
+    cellMeans(w, h, kThumbW, kThumbH, luma, sig.thumb.data());
+
+    // dHash: is each cell brighter than its right neighbour?
+    uchar grid[9 * 8];
+    cellMeans(w, h, 9, 8, luma, grid);
+    for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 8; ++x)
+            if (grid[y * 9 + x] > grid[y * 9 + x + 1])
+                sig.dhash |= quint64(1) << (y * 8 + x);
+    return sig;
+}
+
+SceneSignature sceneSignature(const QImage &img)
+{
+    if (img.isNull()) return SceneSignature();
+    const bool rgb32 = img.format() == QImage::Format_RGB32
+                    || img.format() == QImage::Format_ARGB32
+                    || img.format() == QImage::Format_ARGB32_Premultiplied;
+    return signatureOf(img.width(), img.height(), [&](int x, int y) {
+        return qGray(rgb32 ? reinterpret_cast<const QRgb *>(img.constScanLine(y))[x] : img.pixel(x, y));
+    });
+}
+
+SceneSignature sceneSignature(const QVideoFrame &frame)
+{
+    QVideoFrame f(frame); // shared; mapping it doesn't touch the caller's
+    if (!f.isValid()) return SceneSignature();
+    if (!f.map(QVideoFrame::ReadOnly)) return sceneSignature(frame.toImage()); // e.g. a GPU texture
+    const uchar *bits = f.bits(0);
+    const int bpl = f.bytesPerLine(0);
+    const int w = f.width(), h = f.height();
+
+    // byte offsets of the luma (YUV) or of R, G, B (32-bit RGB) in a pixel
+    int step = 1, y0 = 0, r = -1, g = -1, b = -1;
+    switch (f.pixelFormat()) {
+    case QVideoFrameFormat::Format_NV12:
+    case QVideoFrameFormat::Format_NV21:
+    case QVideoFrameFormat::Format_YUV420P:
+    case QVideoFrameFormat::Format_YUV422P:
+    case QVideoFrameFormat::Format_YV12:
+    case QVideoFrameFormat::Format_IMC1:
+    case QVideoFrameFormat::Format_IMC2:
+    case QVideoFrameFormat::Format_IMC3:
+    case QVideoFrameFormat::Format_IMC4:
+    case QVideoFrameFormat::Format_Y8:
+        break;                                  // plane 0 is 8-bit Y
+    case QVideoFrameFormat::Format_YUYV: step = 2; break;
+    case QVideoFrameFormat::Format_UYVY: step = 2; y0 = 1; break;
+    case QVideoFrameFormat::Format_ARGB8888:
+    case QVideoFrameFormat::Format_ARGB8888_Premultiplied:
+    case QVideoFrameFormat::Format_XRGB8888: r = 1; g = 2; b = 3; break;
+    case QVideoFrameFormat::Format_BGRA8888:
+    case QVideoFrameFormat::Format_BGRA8888_Premultiplied:
+    case QVideoFrameFormat::Format_BGRX8888: r = 2; g = 1; b = 0; break;
+    case QVideoFrameFormat::Format_ABGR8888:
+    case QVideoFrameFormat::Format_XBGR8888: r = 3; g = 2; b = 1; break;
+    case QVideoFrameFormat::Format_RGBA8888:
+    case QVideoFrameFormat::Format_RGBX8888: r = 0; g = 1; b = 2; break;
+    default:
+        // rare formats (16-bit, JPEG): convert once
+        f.unmap();
+        return sceneSignature(frame.toImage());
+    }
+
+    SceneSignature sig;
+    if (r < 0) {
+        sig = signatureOf(w, h, [&](int x, int y) { return int(bits[y * bpl + x * step + y0]); });
+    } else {
+        sig = signatureOf(w, h, [&](int x, int y) {
+            const uchar *p = bits + y * bpl + x * 4;
+            return qGray(p[r], p[g], p[b]);
+        });
+    }
+    f.unmap();
+    return sig;
+}
+
+SceneChange compareScenes(const SceneSignature &a, const SceneSignature &b)
+{
+    SceneChange c;
+    if (a.isNull() || b.isNull() || a.thumb.size() != b.thumb.size()) return c;
+    c.hashBits = qPopulationCount(a.dhash ^ b.dhash);
+    int sum = 0;
+    for (int i = 0; i < a.thumb.size(); ++i)
+        sum += qAbs(int(a.thumb[i]) - int(b.thumb[i]));
+    c.meanDiff = sum / (255.0 * a.thumb.size());
+    return c;
+}
+
+SceneGate::Decision SceneGate::check(const SceneSignature &sig, qint64 nowMs) const
+{
+    Decision d;
+    if (last.isNull()) {
+        d.send = true;
+        d.reason = "first frame";
+        return d;
+    }
+    d.change = compareScenes(last, sig);
+    if (d.change.hashBits >= hashThreshold || d.change.meanDiff >= diffThreshold) {
+        d.send = true;
+        d.reason = "scene changed";
+    } else if (nowMs - lastSentMs >= maxIntervalMs) {
+        d.send = true;
+        d.reason = "max interval";
+    } else {
+        d.reason = "unchanged";
+    }
+    return d;
+}
+
+void SceneGate::markSent(const SceneSignature &sig, qint64 nowMs)
+{
+    last = sig;
+    lastSentMs = nowMs;
+}
+
+void SceneGate::reset()
+{
+    last = SceneSignature();
+    lastSentMs = 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <QImage>
+#include <QVideoFrame>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// What a camera frame looks like at a glance: a 32x24 grayscale thumbnail
+// and a 64-bit difference hash (brightness gradients on a 9x8 grid). Both
+// are box averages of a sparse sample of the frame, so sensor noise and
+// small exposure changes barely move them; computing one costs well under
+// a millisecond whatever the frame size.
+// The QVideoFrame overload reads the mapped frame directly (the Y plane of
+// YUV formats, the bytes of 32-bit RGB formats), so a camera frame is never
+// converted to a full-size QImage just to be compared.
+struct SceneSignature {
+    quint64 dhash = 0;
+    QVector<uchar> thumb;
+    bool isNull() const { return thumb.isEmpty(); }
+};
+
+SceneSignature sceneSignature(const QImage &img);
+SceneSignature sceneSignature(const QVideoFrame &frame);
+
+struct SceneChange {
+    int hashBits = 64;       // differing dhash bits (0..64)
+    double meanDiff = 1.0;   // mean absolute thumbnail difference (0..1)
+};
+
+SceneChange compareScenes(const SceneSignature &a, const SceneSignature &b);
+
+// Decides whether a new frame is worth describing: only if it differs
+// enough from the last frame that was described, or if that was too long
+// ago. Otherwise the previous description still applies.
+class SceneGate {
+public:
+    struct Decision {
+        bool send = false;
+        QString reason;          // "first frame", "scene changed", "max interval", "unchanged"
+        SceneChange change;
+    };
+
+    void setThresholds(int hashBits, double meanDiff) { hashThreshold = hashBits; diffThreshold = meanDiff; }
+    void setMaxIntervalMs(qint64 ms) { maxIntervalMs = ms; }
+
+    Decision check(const SceneSignature &sig, qint64 nowMs) const;
+    void markSent(const SceneSignature &sig, qint64 nowMs);   // sig has been described
+    void reset();
+
+private:
+    int hashThreshold = 10;      // of 64 bits
+    double diffThreshold = 0.06; // 6% of full scale
+    qint64 maxIntervalMs = 60000;
+
+    SceneSignature last;
+    qint64 lastSentMs = 0;
+};
@@ -0,0 +1,74 @@
+#include "sensorlog.h"
+
+#include <QtEndian>
+#include <cstring>
+
+static const int kRecordHeader = 12;
+static const quint32 kPacketBit = 0x80000000u;
+
+bool SensorLogWriter::open(const QString &path)
+{
+    close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    file.write(SensorLogReader::magic(), SensorLogReader::kHeaderSize);
+    written = SensorLogReader::kHeaderSize;
+    return true;
+}
+
+void SensorLogWriter::close()
+{
+    if (file.isOpen()) file.close();
+}
+
+void SensorLogWriter::append(qint64 timeUs, const char *data, qint64 n, bool packet)
+{
+    if (!file.isOpen() || n <= 0) return;
+    uchar head[kRecordHeader];
+    qToLittleEndian<qint64>(timeUs, head);
+    qToLittleEndian<quint32>(quint32(n) | (packet ? kPacketBit : 0), head + 8);
+    file.write(reinterpret_cast<const char *>(head), kRecordHeader);
+    file.write(data, n);   // QFile buffers, the OS sees large writes
+    written += kRecordHeader + n;
+}
+
+bool SensorLogReader::open(const QString &path, QString *error)
+{
+    close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    mapSize = file.size();
+    map = mapSize >= kHeaderSize ? file.map(0, mapSize) : nullptr;
+    if (!map || std::memcmp(map, magic(), kHeaderSize) != 0) {
+        if (error) *error = map ? "Not a sensor log." : file.errorString();
+        close();
+        return false;
+    }
+    pos = kHeaderSize;
+    return true;
+}
+
+void SensorLogReader::close()
+{
+    if (map) file.unmap(const_cast<uchar *>(map));
+    map = nullptr;
+    mapSize = 0;
+    pos = 0;
+    if (file.isOpen()) file.close();
+}
+
+bool SensorLogReader::next(qint64 &timeUs, const char *&data, quint32 &n, bool *packet)
+{
+    if (!map || pos + kRecordHeader > mapSize) return false;
+    timeUs = qFromLittleEndian<qint64>(map + pos);
+    n = qFromLittleEndian<quint32>(map + pos + 8);
+    if (packet) *packet = n & kPacketBit;
+    n &= ~kPacketBit;
+    if (pos + kRecordHeader + qint64(n) > mapSize) return false; // cut off while recording
+    data = reinterpret_cast<const char *>(map + pos + kRecordHeader);
+    pos += kRecordHeader + n;
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+// Binary session log: everything the sensor link delivered, as received.
+//   header  "SSLOG1\0\0"
+//   record  qint64 timeUs, quint32 length, length raw bytes (little endian)
+//           the top bit of length marks a UDP packet (SensorPacket) instead
+//           of serial bytes
+// Replaying the raw bytes runs them through the same SensorParser as live
+// data, so a replay reproduces the parser counters too.
+
+class SensorLogWriter {
+public:
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+    void append(qint64 timeUs, const char *data, qint64 n, bool packet = false);
+    qint64 bytesWritten() const { return written; }
+
+private:
+    QFile file;
+    qint64 written = 0;
+};
+
+// Memory-mapped reader; records are read in place, nothing is copied.
+class SensorLogReader {
+public:
+    ~SensorLogReader() { close(); }
+    bool open(const QString &path, QString *error = nullptr);
+    void close();
+
+    // next record; false at the end (or on a truncated record)
+    bool next(qint64 &timeUs, const char *&data, quint32 &n, bool *packet = nullptr);
+    void rewind() { pos = kHeaderSize; }
+
+    qint64 size() const { return mapSize; }
+    qint64 position() const { return pos; }
+
+    static const int kHeaderSize = 8;
+    static const char *magic() { return "SSLOG1\0\0"; }
+
+private:
+    QFile file;
+    const uchar *map = nullptr;
+    qint64 mapSize = 0;
+    qint64 pos = 0;
+};
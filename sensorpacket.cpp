@@ -0,0 +1,54 @@
+#include "sensorpacket.h"
+
+#include <QtEndian>
+
+namespace SensorPacket {
+
+static const quint8 kVersion = 1;
+
+bool decode(const char *data, qint64 n, quint32 &sequence, QVector<SensorSample> &out)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(data);
+    if (n < kHeaderSize || p[0] != 'S' || p[1] != 'P' || p[2] != kVersion) return false;
+    const int count = p[3];
+    if (n != kHeaderSize + qint64(count) * kSampleSize) return false;
+
+    sequence = qFromLittleEndian<quint32>(p + 4);
+    const qint64 base = qFromLittleEndian<qint64>(p + 8);
+
+    p += kHeaderSize;
+    for (int i = 0; i < count; ++i, p += kSampleSize) {
+        SensorSample s;
+        s.timeUs = base + qFromLittleEndian<quint32>(p);
+        s.channel = p[4];
+        s.value = qFromLittleEndian<qint16>(p + 6);
+        if (s.channel == 0 || s.channel > SensorParser::kMaxChannel) continue;
+        out.append(s);
+    }
+    return true;
+}
+
+QByteArray encode(quint32 sequence, qint64 baseTimeUs, const QVector<SensorSample> &samples)
+{
+    const int count = qMin(kMaxSamples, samples.size());
+    QByteArray packet(kHeaderSize + count * kSampleSize, '\0');
+    uchar *p = reinterpret_cast<uchar *>(packet.data());
+    p[0] = 'S';
+    p[1] = 'P';
+    p[2] = kVersion;
+    p[3] = uchar(count);
+    qToLittleEndian<quint32>(sequence, p + 4);
+    qToLittleEndian<qint64>(baseTimeUs, p + 8);
+
+    p += kHeaderSize;
+    for (int i = 0; i < count; ++i, p += kSampleSize) {
+        const SensorSample &s = samples[i];
+        qToLittleEndian<quint32>(quint32(s.timeUs - baseTimeUs), p);
+        p[4] = s.channel;
+        p[5] = 0;
+        qToLittleEndian<qint16>(qint16(s.value), p + 6);
+    }
+    return packet;
+}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <QByteArray>
+#include <QVector>
+
+#include "sensorparser.h"
+
+// UDP telemetry from the Raspberry Pi: one datagram carries a batch of
+// readings timestamped on the Pi (all little endian).
+//   header  "SP", version (1), count, sequence (u32), base time us (i64)
+//   sample  time offset us (u32), channel (u8), flags (u8), value (i16)
+// 16 + 8 * count bytes; at most kMaxSamples so a packet fits one Ethernet
+// frame (1472 byte UDP payload). Missing sequence numbers count as lost.
+namespace SensorPacket {
+
+const int kHeaderSize = 16;
+const int kSampleSize = 8;
+const int kMaxSamples = 182;
+
+// false if the datagram is not a valid packet; samples are appended to out
+bool decode(const char *data, qint64 n, quint32 &sequence, QVector<SensorSample> &out);
+
+// what the Pi sends (also handy for tests and simulators); at most
+// kMaxSamples of samples go in, all within 71 minutes of baseTimeUs
+QByteArray encode(quint32 sequence, qint64 baseTimeUs, const QVector<SensorSample> &samples);
+
+}
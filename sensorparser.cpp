@@ -0,0 +1,136 @@
+#include "sensorparser.h"
+
+static const int kMaxLine = 32; // longest sane text reading
+
+SensorParser::SensorParser(int capacity)
+{
+    int cap = 64;
+    while (cap < capacity) cap <<= 1;
+    ring.resize(cap);
+    mask = quint32(cap - 1);
+    line.reserve(kMaxLine);
+}
+
+void SensorParser::reset()
+{
+    head = tail = 0;
+    line.clear();
+    lineOverflow = false;
+    frameCount = malformedCount = droppedCount = 0;
+}
+
+quint8 SensorParser::crc8(const uchar *data, int n)
+{
+    quint8 crc = 0;
+    for (int i = 0; i < n; ++i) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; ++b)
+            crc = (crc & 0x80) ? quint8((crc << 1) ^ 0x07) : quint8(crc << 1);
+    }
+    return crc;
+}
+
+QByteArray SensorParser::encodeFrame(quint8 channel, qint16 value)
+{
+    uchar f[kFrameSize] = {kSync, channel, uchar(quint16(value) & 0xff), uchar(quint16(value) >> 8), 0};
+    f[4] = crc8(f + 1, 3);
+    return QByteArray(reinterpret_cast<const char *>(f), kFrameSize);
+}
+
+void SensorParser::feed(const char *data, qint64 n, qint64 timeUs, QVector<SensorSample> &out)
+{
+    const int cap = ring.size();
+    while (n > 0) {
+        // fill what fits, parse, repeat; only a partial frame stays behind
+        const int room = cap - available();
+        if (room == 0) { // cannot happen unless a frame never completes
+            ++head;
+            ++droppedCount;
+            continue;
+        }
+        const int chunk = int(qMin<qint64>(n, room));
+        for (int i = 0; i < chunk; ++i)
+            ring[int((tail + quint32(i)) & mask)] = uchar(data[i]);
+        tail += quint32(chunk);
+        data += chunk;
+        n -= chunk;
+        parse(timeUs, out);
+    }
+}
+
+void SensorParser::parse(qint64 timeUs, QVector<SensorSample> &out)
+{
+    while (available() > 0) {
+        const uchar b = at(0);
+
+        if (b == kSync) {
+            if (!line.isEmpty() || lineOverflow) { // text cut off by a frame
+                ++malformedCount;
+                line.clear();
+                lineOverflow = false;
+            }
+            if (available() < kFrameSize) return; // wait for the rest
+            uchar f[kFrameSize];
+            for (int i = 0; i < kFrameSize; ++i) f[i] = at(i);
+            if (crc8(f + 1, 3) != f[4] || f[1] == 0 || f[1] > kMaxChannel) {
+                // not a frame after all: skip the sync byte and look again
+                ++malformedCount;
+                ++droppedCount;
+                ++head;
+                continue;
+            }
+            head += kFrameSize;
+            SensorSample s;
+            s.timeUs = timeUs;
+            s.channel = f[1];
+            s.value = qint16(quint16(f[2]) | quint16(f[3]) << 8);
+            out.append(s);
+            ++frameCount;
+            continue;
+        }
+
+        ++head;
+        if (b == '\n') {
+            parseLine(timeUs, out);
+        } else if (line.size() < kMaxLine) {
+            line.append(char(b));
+        } else {
+            lineOverflow = true; // keep eating until the newline
+            ++droppedCount;
+        }
+    }
+}
+
+void SensorParser::parseLine(qint64 timeUs, QVector<SensorSample> &out)
+{
+    const QByteArray text = line.trimmed();
+    const bool overflow = lineOverflow;
+    line.clear();
+    lineOverflow = false;
+    if (text.isEmpty()) return;
+    if (overflow) { ++malformedCount; return; }
+
+    // "123" -> sensor 1, "2:45" / "2,45" / "S2:45" -> sensor 2
+    int channel = 1;
+    QByteArray value = text;
+    const int sep = qMax(text.indexOf(':'), text.indexOf(','));
+    if (sep >= 0) {
+        QByteArray id = text.left(sep).trimmed();
+        if (id.startsWith('S') || id.startsWith('s')) id.remove(0, 1);
+        bool idOk = false;
+        channel = id.toInt(&idOk);
+        if (!idOk || channel < 1 || channel > kMaxChannel) { ++malformedCount; return; }
+        value = text.mid(sep + 1).trimmed();
+    }
+
+    bool ok = false;
+    const int v = value.toInt(&ok);
+    if (!ok) { ++malformedCount; return; }
+
+    SensorSample s;
+    s.timeUs = timeUs;
+    s.channel = quint8(channel);
+    s.value = v;
+    out.append(s);
+    ++frameCount;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+
+// One reading from the car
+struct SensorSample {
+    qint64 timeUs = 0;   // receive time (or sender time when it has one)
+    quint8 channel = 0;  // sensor number, 1 = labelSensor1, 2 = labelSensor2...
+    qint32 value = 0;    // distance in cm
+};
+
+// Streaming parser for the sensor link. Bytes go into a fixed ring buffer
+// and complete readings come out, however the bytes were split across reads.
+// Two formats can be mixed on one stream:
+//   text lines   "123\n" (sensor 1) or "2:45\n" / "S2,45\r\n"
+//   binary frame 0xAA, channel, value (int16 little endian), CRC-8 of the
+//                three bytes before it (poly 0x07)
+// 0xAA never occurs in text, so it doubles as the frame sync byte.
+class SensorParser {
+public:
+    static const int kMaxChannel = 8;
+    static const uchar kSync = 0xAA;
+    static const int kFrameSize = 5;
+
+    explicit SensorParser(int capacity = 4096);
+
+    // Append n bytes and parse; samples are appended to out with timeUs
+    void feed(const char *data, qint64 n, qint64 timeUs, QVector<SensorSample> &out);
+    void reset();
+
+    quint64 frames() const { return frameCount; }        // good readings
+    quint64 malformed() const { return malformedCount; } // bad CRC, garbage lines
+    quint64 droppedBytes() const { return droppedCount; }// ring overflow, resync
+
+    static quint8 crc8(const uchar *data, int n);
+    static QByteArray encodeFrame(quint8 channel, qint16 value);
+
+private:
+    int available() const { return int(tail - head); }
+    uchar at(int i) const { return ring[int((head + quint32(i)) & mask)]; }
+    void parse(qint64 timeUs, QVector<SensorSample> &out);
+    void parseLine(qint64 timeUs, QVector<SensorSample> &out);
+
+    QVector<uchar> ring;
+    quint32 mask = 0;
+    quint32 head = 0;
+    quint32 tail = 0;
+
+    QByteArray line;         // text line being collected
+    bool lineOverflow = false;
+
+    quint64 frameCount = 0;
+    quint64 malformedCount = 0;
+    quint64 droppedCount = 0;
+};
@@ -0,0 +1,88 @@
+#include "sensorplot.h"
+#include "timeseries.h"
+
+#include <QLine>
+#include <QPainter>
+#include <climits>
+
+SensorPlot::SensorPlot(QWidget *parent)
+    : QWidget(parent)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumHeight(120);
+}
+
+void SensorPlot::addSeries(const TimeSeries *series, const QColor &color, const QString &name)
+{
+    traces.append({series, color, name});
+    update();
+}
+
+void SensorPlot::paintEvent(QPaintEvent *)
+{
+    QPainter p(this);
+    p.fillRect(rect(), QColor(20, 20, 20));
+
+    const QRect area = rect().adjusted(40, 8, -8, -18);
+    if (area.width() < 2 || area.height() < 2) return;
+
+    // common time axis: the window ending at the newest sample of any trace
+    qint64 t1 = LLONG_MIN;
+    for (const Trace &tr : traces)
+        if (!tr.series->isEmpty()) t1 = qMax(t1, tr.series->lastTime());
+    if (t1 == LLONG_MIN) {
+        p.setPen(Qt::gray);
+        p.drawText(area, Qt::AlignCenter, "No data");
+        return;
+    }
+    const qint64 t0 = t1 - windowUs;
+    const int columns = area.width();
+
+    // decimate every trace first to find the value range
+    QVector<QVector<qint32>> traceMin(traces.size()), traceMax(traces.size());
+    qint32 lo = INT_MAX, hi = INT_MIN;
+    for (int k = 0; k < traces.size(); ++k) {
+        traces[k].series->decimate(t0, t1 + 1, columns, mins, maxs);
+        for (int c = 0; c < columns; ++c) {
+            if (mins[c] > maxs[c]) continue;
+            lo = qMin(lo, mins[c]);
+            hi = qMax(hi, maxs[c]);
+        }
+        traceMin[k] = mins;
+        traceMax[k] = maxs;
+    }
+    if (lo > hi) return;
+    if (lo == hi) { --lo; ++hi; }
+    auto yOf = [&](qint32 v) {
+        return area.bottom() - int(double(v - lo) * (area.height() - 1) / double(hi - lo));
+    };
+
+    // axes
+    p.setPen(QColor(80, 80, 80));
+    p.drawRect(area);
+    p.setPen(Qt::gray);
+    p.drawText(QRect(0, area.top() - 6, 36, 14), Qt::AlignRight, QString::number(hi));
+    p.drawText(QRect(0, area.bottom() - 8, 36, 14), Qt::AlignRight, QString::number(lo));
+    p.drawText(QRect(area.left(), area.bottom() + 2, area.width(), 14), Qt::AlignLeft,
+               QString("-%1 s").arg(windowUs / 1e6, 0, 'f', 0));
+
+    // one vertical segment per column plus a joint to the next column
+    QVector<QLine> lines;
+    lines.reserve(columns * 2);
+    for (int k = 0; k < traces.size(); ++k) {
+        lines.clear();
+        int prevY = INT_MIN;
+        for (int c = 0; c < columns; ++c) {
+            const qint32 mn = traceMin[k][c], mx = traceMax[k][c];
+            if (mn > mx) { prevY = INT_MIN; continue; }
+            const int x = area.left() + c;
+            const int yTop = yOf(mx), yBottom = yOf(mn);
+            lines.append(QLine(x, yTop, x, yBottom));
+            if (prevY != INT_MIN) lines.append(QLine(x - 1, prevY, x, (yTop + yBottom) / 2));
+            prevY = (yTop + yBottom) / 2;
+        }
+        p.setPen(traces[k].color);
+        p.drawLines(lines);
+        p.drawText(area.right() - 120, area.top() + 14 + 14 * k, traces[k].name);
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <QColor>
+#include <QVector>
+#include <QWidget>
+
+class TimeSeries;
+
+// Scrolling plot of one or more TimeSeries. Each pixel column shows the
+// min..max of the samples that fall into it, so the cost of a repaint
+// depends on the widget width, not on the number of samples.
+class SensorPlot : public QWidget {
+    Q_OBJECT
+public:
+    explicit SensorPlot(QWidget *parent = nullptr);
+
+    void addSeries(const TimeSeries *series, const QColor &color, const QString &name);
+    void setWindowSeconds(double seconds) { windowUs = qint64(seconds * 1e6); update(); }
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    struct Trace { const TimeSeries *series; QColor color; QString name; };
+    QVector<Trace> traces;
+    qint64 windowUs = 10 * 1000000LL;
+
+    QVector<qint32> mins, maxs; // reused between paints
+};
@@ -0,0 +1,237 @@
+#include "sensorreader.h"
+#include "perfstats.h"
+
+#include <QFileInfo>
+#include <QNetworkDatagram>
+
+SensorReader::SensorReader(QObject *parent)
+    : QObject(parent), samples(1 << 16)
+{
+    clock.start();
+}
+
+void SensorReader::openSerial(const QString &portName, int baud)
+{
+    close();
+    serial = new QSerialPort(this);
+    serial->setPortName(portName);
+    serial->setBaudRate(baud);
+    serial->setDataBits(QSerialPort::Data8);
+    serial->setParity(QSerialPort::NoParity);
+    serial->setStopBits(QSerialPort::OneStop);
+    serial->setFlowControl(QSerialPort::NoFlowControl);
+    serial->setReadBufferSize(64 * 1024);
+
+    if (!serial->open(QIODevice::ReadOnly)) {
+        const QString error = serial->errorString();
+        delete serial;
+        serial = nullptr;
+        emit opened(false, QString("Failed to open %1: %2").arg(portName, error));
+        return;
+    }
+
+    parser.reset();
+    publishCounters();
+    connect(serial, &QSerialPort::readyRead, this, &SensorReader::readSerial);
+    emit opened(true, QString("%1 @ %2 baud").arg(portName).arg(baud));
+}
+
+void SensorReader::openUdp(quint16 port)
+{
+    close();
+    udp = new QUdpSocket(this);
+    if (!udp->bind(QHostAddress::AnyIPv4, port)) {
+        const QString error = udp->errorString();
+        delete udp;
+        udp = nullptr;
+        emit opened(false, QString("Failed to listen on UDP %1: %2").arg(port).arg(error));
+        return;
+    }
+    udp->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, 1 << 20);
+
+    parser.reset();
+    haveSequence = false;
+    packetFrames = badPackets = 0;
+    lostCount.store(0, std::memory_order_relaxed);
+    publishCounters();
+    connect(udp, &QUdpSocket::readyRead, this, &SensorReader::readUdp);
+    emit opened(true, QString("UDP port %1").arg(port));
+}
+
+void SensorReader::close()
+{
+    if (udp) {
+        udp->close();
+        delete udp;
+        udp = nullptr;
+        emit closed();
+    }
+    if (replaying) {
+        replayTimer->stop();
+        replay.close();
+        replaying = false;
+        emit closed();
+    }
+    if (!serial) return;
+    serial->close();
+    delete serial;
+    serial = nullptr;
+    emit closed();
+}
+
+void SensorReader::readSerial()
+{
+    const QByteArray data = serial->readAll();
+    const qint64 now = clock.nsecsElapsed() / 1000;
+    recorder.append(now, data.constData(), data.size());
+    ingest(now, data.constData(), data.size());
+    publishCounters();
+}
+
+void SensorReader::readUdp()
+{
+    while (udp->hasPendingDatagrams()) {
+        const QNetworkDatagram d = udp->receiveDatagram();
+        const QByteArray data = d.data();
+        const qint64 now = clock.nsecsElapsed() / 1000;
+        recorder.append(now, data.constData(), data.size(), true);
+        ingestPacket(now, data.constData(), data.size());
+    }
+    publishCounters();
+}
+
+void SensorReader::ingestPacket(qint64, const char *data, qint64 n)
+{
+    // readings carry the Pi's own timestamps, so receive time is not used
+    PerfScope scope("sensor.decode");
+    batch.clear();
+    quint32 seq = 0;
+    if (!SensorPacket::decode(data, n, seq, batch)) {
+        ++badPackets;
+        PerfStats::count("sensor.malformed");
+        return;
+    }
+    if (haveSequence && seq != nextSequence) {
+        const quint32 gap = seq - nextSequence;
+        if (gap < 0x80000000u) // older/duplicate packets are not losses
+            lostCount.fetch_add(gap, std::memory_order_relaxed);
+    }
+    haveSequence = true;
+    nextSequence = seq + 1;
+    packetFrames += batch.size();
+    push(batch);
+}
+
+void SensorReader::ingest(qint64 timeUs, const char *data, qint64 n)
+{
+    PerfScope scope("sensor.parse");
+    const quint64 bad = parser.malformed();
+    batch.clear();
+    parser.feed(data, n, timeUs, batch);
+    PerfStats::count("sensor.malformed", qint64(parser.malformed() - bad));
+    push(batch);
+}
+
+void SensorReader::push(const QVector<SensorSample> &batch)
+{
+    for (const SensorSample &s : batch)
+        if (!samples.tryPush(s))
+            overflowCount.fetch_add(1, std::memory_order_relaxed); // GUI is far behind
+}
+
+void SensorReader::publishCounters()
+{
+    frameCount.store(parser.frames() + packetFrames, std::memory_order_relaxed);
+    malformedCount.store(parser.malformed() + badPackets, std::memory_order_relaxed);
+    droppedCount.store(parser.droppedBytes(), std::memory_order_relaxed);
+}
+
+/* ======== Recording ======== */
+
+void SensorReader::startRecording(const QString &path)
+{
+    if (!recorder.open(path)) {
+        emit recording(false, "Could not write " + path);
+        return;
+    }
+    emit recording(true, "Recording to " + path);
+}
+
+void SensorReader::stopRecording()
+{
+    if (!recorder.isOpen()) return;
+    const qint64 bytes = recorder.bytesWritten();
+    recorder.close();
+    emit recording(false, QString("Recording stopped (%1 KB)").arg(bytes / 1024));
+}
+
+/* ======== Replay ======== */
+
+void SensorReader::openReplay(const QString &path, bool realTime)
+{
+    close();
+    QString error;
+    if (!replay.open(path, &error)) {
+        emit opened(false, "Cannot replay " + path + ": " + error);
+        return;
+    }
+
+    if (!replayTimer) {
+        replayTimer = new QTimer(this);
+        connect(replayTimer, &QTimer::timeout, this, &SensorReader::replayStep);
+    }
+    parser.reset();
+    haveSequence = false;
+    packetFrames = badPackets = 0;
+    lostCount.store(0, std::memory_order_relaxed);
+    publishCounters();
+    replaying = true;
+    replayRealTime = realTime;
+    replayFirstUs = -1;
+    pendingValid = false;
+    replayRecords = replayBytes = 0;
+    replayClock.start();
+    replayTimer->start(realTime ? 5 : 0);
+
+    emit opened(true, QString("Replay %1 (%2)").arg(QFileInfo(path).fileName(),
+                                                    realTime ? "1x" : "max speed"));
+}
+
+void SensorReader::replayStep()
+{
+    // bounded slices so close() and the GUI's signals still get through
+    QElapsedTimer slice;
+    slice.start();
+    while (slice.elapsed() < 20) {
+        if (!pendingValid) {
+            if (!replay.next(pendingTime, pendingData, pendingSize, &pendingPacket)) {
+                const double ms = replayClock.nsecsElapsed() / 1e6;
+                const quint64 readings = parser.frames() + packetFrames; // text/binary + packets
+                const QString summary = QString("Replay done: %1 records, %2 KB, %3 readings in %4 ms (%5 readings/s)")
+                        .arg(replayRecords).arg(replayBytes / 1024).arg(readings)
+                        .arg(ms, 0, 'f', 1).arg(ms > 0 ? readings * 1000.0 / ms : 0.0, 0, 'f', 0);
+                publishCounters();
+                close();
+                emit replayFinished(summary);
+                return;
+            }
+            pendingValid = true;
+            if (replayFirstUs < 0) replayFirstUs = pendingTime;
+        }
+
+        // 1x: wait until the record is due
+        if (replayRealTime && pendingTime - replayFirstUs > replayClock.nsecsElapsed() / 1000)
+            break;
+        // never drop during a replay: wait for the GUI to drain the queue
+        // (a text reading is at least 2 bytes)
+        if (samples.freeSpace() < pendingSize / 2 + 1)
+            break;
+
+        if (pendingPacket) ingestPacket(pendingTime, pendingData, pendingSize);
+        else ingest(pendingTime, pendingData, pendingSize);
+        ++replayRecords;
+        replayBytes += pendingSize;
+        pendingValid = false;
+    }
+    publishCounters();
+}
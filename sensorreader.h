@@ -0,0 +1,89 @@
+#pragma once
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QVector>
+#include <QtSerialPort/QSerialPort>
+#include <atomic>
+
+#include "sensorlog.h"
+#include "sensorpacket.h"
+#include "sensorparser.h"
+#include "spscqueue.h"
+
+// Lives on the dashboard's I/O thread: owns the serial port (or the UDP
+// socket the Raspberry Pi sends SensorPacket batches to) and the parser
+// and pushes every reading into a lock-free queue for the GUI thread.
+// The GUI never waits for it and it never waits for the GUI.
+// It can also record the raw link to a SensorLog and replay one through the
+// same parser, at the recorded pace or as fast as the queue drains.
+class SensorReader : public QObject {
+    Q_OBJECT
+public:
+    explicit SensorReader(QObject *parent = nullptr);
+
+    SpscQueue<SensorSample> &queue() { return samples; }
+
+    // counters, readable from any thread
+    quint64 frames() const { return frameCount.load(std::memory_order_relaxed); }
+    quint64 malformed() const { return malformedCount.load(std::memory_order_relaxed); }
+    quint64 droppedBytes() const { return droppedCount.load(std::memory_order_relaxed); }
+    quint64 queueOverflows() const { return overflowCount.load(std::memory_order_relaxed); }
+    quint64 lostPackets() const { return lostCount.load(std::memory_order_relaxed); }
+
+public slots:
+    // call through a queued connection / invokeMethod
+    void openSerial(const QString &portName, int baud);
+    void openUdp(quint16 port);
+    void openReplay(const QString &path, bool realTime);
+    void close();
+
+    void startRecording(const QString &path);
+    void stopRecording();
+
+signals:
+    void opened(bool ok, const QString &message);
+    void closed();
+    void recording(bool on, const QString &message);
+    void replayFinished(const QString &summary);
+
+private:
+    void readSerial();
+    void readUdp();
+    void ingestPacket(qint64 timeUs, const char *data, qint64 n);
+    void replayStep();
+    void ingest(qint64 timeUs, const char *data, qint64 n);
+    void push(const QVector<SensorSample> &batch);
+    void publishCounters();
+
+    QSerialPort *serial = nullptr;   // created on the I/O thread
+    QUdpSocket *udp = nullptr;
+    bool haveSequence = false;
+    quint32 nextSequence = 0;
+    quint64 packetFrames = 0;        // readings that came in packets
+    quint64 badPackets = 0;
+    SensorParser parser;
+    QVector<SensorSample> batch;     // reused for every read
+    QElapsedTimer clock;
+
+    SensorLogWriter recorder;
+
+    // replay
+    SensorLogReader replay;
+    QTimer *replayTimer = nullptr;
+    bool replaying = false;
+    bool replayRealTime = true;
+    QElapsedTimer replayClock;
+    qint64 replayFirstUs = -1;
+    bool pendingValid = false;       // record read but not fed yet
+    qint64 pendingTime = 0;
+    const char *pendingData = nullptr;
+    quint32 pendingSize = 0;
+    bool pendingPacket = false;
+    quint64 replayRecords = 0;
+    quint64 replayBytes = 0;
+
+    SpscQueue<SensorSample> samples;
+    std::atomic<quint64> frameCount{0}, malformedCount{0}, droppedCount{0}, overflowCount{0}, lostCount{0};
+};
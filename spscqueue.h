@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity is rounded up to a power of two and allocated once.
+// Head and tail live on separate cache lines so the two threads don't
+// fight over one line on every push/pop.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity = 1 << 14)
+    {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        buf.resize(cap);
+        mask = cap - 1;
+    }
+
+    // producer side; false if full (the item is not queued)
+    bool tryPush(const T &v)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == buf.size()) return false;
+        buf[t & mask] = v;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side; false if empty
+    bool tryPop(T &v)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        v = buf[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // producer side: at least this many pushes will succeed
+    size_t freeSpace() const
+    {
+        return buf.size() - (tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire));
+    }
+
+    size_t capacity() const { return buf.size(); }
+
+private:
+    std::vector<T> buf;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+};
@@ -0,0 +1,43 @@
+#include "sseparser.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+
+QList<QByteArray> SseParser::feed(const QByteArray &chunk)
+{
+    QList<QByteArray> events;
+    pending.append(chunk);
+
+    int start = 0;
+    for (;;) {
+        const int nl = pending.indexOf('\n', start);
+        if (nl < 0) break;
+        QByteArray line = pending.mid(start, nl - start);
+        start = nl + 1;
+        if (line.endsWith('\r')) line.chop(1);
+
+        if (line.isEmpty()) {               // blank line ends the event
+            if (!data.isEmpty()) events.append(data);
+            data.clear();
+        } else if (line.startsWith("data:")) {
+            QByteArray v = line.mid(5);
+            if (v.startsWith(' ')) v.remove(0, 1);
+            if (!data.isEmpty()) data.append('\n');
+            data.append(v);
+        }
+        // "event:", "id:", "retry:" and ":" comments are not used by the API
+    }
+    pending.remove(0, start);
+    return events;
+}
+
+QString completionDelta(const QByteArray &eventData)
+{
+    const QJsonDocument doc = QJsonDocument::fromJson(eventData);
+    if (!doc.isObject()) return {};
+    const QJsonArray choices = doc.object()["choices"].toArray();
+    if (choices.isEmpty()) return {};
+    return choices[0].toObject()["delta"].toObject()["content"].toString();
+}
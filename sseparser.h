@@ -0,0 +1,20 @@
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// Incremental parser for server-sent events (text/event-stream).
+// Feed it whatever readyRead delivers; it returns the data payload of every
+// event completed so far and keeps partial lines for the next call.
+class SseParser {
+public:
+    QList<QByteArray> feed(const QByteArray &chunk);
+    void reset() { pending.clear(); data.clear(); }
+
+private:
+    QByteArray pending; // bytes after the last complete line
+    QByteArray data;    // data lines of the event being read
+};
+
+// Text of one chat completion stream chunk: choices[0].delta.content
+QString completionDelta(const QByteArray &eventData);
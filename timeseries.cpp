@@ -0,0 +1,99 @@
+#include "timeseries.h"
+
+#include <climits>
+
+TimeSeries::TimeSeries(int capacity)
+{
+    int cap = kBlock;
+    while (cap < capacity) cap <<= 1;
+    times.resize(cap);
+    values.resize(cap);
+    blockMin.resize(cap / kBlock);
+    blockMax.resize(cap / kBlock);
+    mask = cap - 1;
+}
+
+void TimeSeries::clear()
+{
+    start = 0;
+    count = 0;
+}
+
+void TimeSeries::append(qint64 timeUs, qint32 value)
+{
+    const int cap = times.size();
+    int p;
+    if (count < cap) {
+        p = phys(count);
+        ++count;
+    } else {
+        p = start;               // overwrite the oldest
+        start = (start + 1) & mask;
+    }
+    times[p] = timeUs;
+    values[p] = value;
+
+    // the block summary only covers what was written since the block restarted
+    const int b = p / kBlock;
+    if (p % kBlock == 0) {
+        blockMin[b] = blockMax[b] = value;
+    } else {
+        blockMin[b] = qMin(blockMin[b], value);
+        blockMax[b] = qMax(blockMax[b], value);
+    }
+}
+
+int TimeSeries::lowerBound(qint64 timeUs) const
+{
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if (timeAt(mid) < timeUs) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+void TimeSeries::rangeMinMax(int i0, int i1, qint32 &lo, qint32 &hi) const
+{
+    // The block being written holds new and old samples, its summary only
+    // knows the new ones; never use it.
+    const int writing = count == 0 ? -1 : phys(count - 1) / kBlock;
+    int i = i0;
+    while (i < i1) {
+        const int p = phys(i);
+        if (p % kBlock == 0 && i + kBlock <= i1 && p / kBlock != writing) {
+            lo = qMin(lo, blockMin[p / kBlock]);
+            hi = qMax(hi, blockMax[p / kBlock]);
+            i += kBlock;
+        } else {
+            const qint32 v = values[p];
+            lo = qMin(lo, v);
+            hi = qMax(hi, v);
+            ++i;
+        }
+    }
+}
+
+void TimeSeries::decimate(qint64 t0, qint64 t1, int columns,
+                          QVector<qint32> &mins, QVector<qint32> &maxs) const
+{
+    mins.fill(INT_MAX, qMax(0, columns));
+    maxs.fill(INT_MIN, qMax(0, columns));
+    if (columns <= 0 || t1 <= t0 || count == 0) return;
+
+    int i = lowerBound(t0);
+    const double perColumn = double(t1 - t0) / columns;
+    for (int c = 0; c < columns && i < count; ++c) {
+        const qint64 colEnd = (c == columns - 1) ? t1 : t0 + qint64((c + 1) * perColumn);
+        // samples are sorted, so find this column's end by binary search
+        int lo = i, hi = count;
+        while (lo < hi) {
+            const int mid = (lo + hi) / 2;
+            if (timeAt(mid) < colEnd) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo > i) rangeMinMax(i, lo, mins[c], maxs[c]);
+        i = lo;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <QVector>
+#include <QtGlobal>
+
+// Fixed-capacity time series of one sensor channel. Memory is allocated
+// once; when full, the oldest samples are overwritten. Times must not go
+// backwards.
+// Every 64 samples also keep their min/max, so decimating minutes of kHz
+// data to a few hundred pixel columns mostly reads the block summaries.
+class TimeSeries {
+public:
+    static const int kBlock = 64;
+
+    explicit TimeSeries(int capacity = 1 << 19);
+
+    void append(qint64 timeUs, qint32 value);
+    void clear();
+
+    int size() const { return count; }
+    int capacity() const { return times.size(); }
+    bool isEmpty() const { return count == 0; }
+
+    // i = 0 is the oldest sample still stored
+    qint64 timeAt(int i) const { return times[phys(i)]; }
+    qint32 valueAt(int i) const { return values[phys(i)]; }
+    qint64 firstTime() const { return timeAt(0); }
+    qint64 lastTime() const { return timeAt(count - 1); }
+
+    // first sample with time >= t
+    int lowerBound(qint64 timeUs) const;
+
+    // min/max of the samples in [t0, t1) split into `columns` equal time
+    // slots. Empty slots get min > max.
+    void decimate(qint64 t0, qint64 t1, int columns, QVector<qint32> &mins, QVector<qint32> &maxs) const;
+
+private:
+    int phys(int i) const { return (start + i) & mask; }
+    void rangeMinMax(int i0, int i1, qint32 &lo, qint32 &hi) const;
+
+    QVector<qint64> times;
+    QVector<qint32> values;
+    QVector<qint32> blockMin, blockMax;
+    int mask = 0;
+    int start = 0;      // physical index of the oldest sample
+    int count = 0;
+};